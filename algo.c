@@ -1,7 +1,12 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "algo.h"
 
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
+#include <unistd.h>
 
 void board_create (board * self)
 {
@@ -13,16 +18,27 @@ void board_create (board * self)
   self->cops = 0;
   self->robbers = 0;
   self->max_turn = 0;
+  self->weighted = false;
+  self->order = BOARD_ORDER_FILE;
+
+  self->components = 0;
 
   self->vertices = NULL;
+  self->component = NULL;
+  self->local = NULL;
+  self->members = NULL;
+  self->offset = NULL;
   self->dist = NULL;
   self->next = NULL;
+  self->words = 0;
+  self->neighborhoods = NULL;
 }
 
 /*
  * Auxiliary function to factorize code
  */
-void board_add_edge_uni (board_vertex * source, board_vertex * destination)
+void board_add_edge_uni (board_vertex * source, board_vertex * destination,
+                         unsigned int weight)
 {
   if (source == NULL || destination == NULL)
     {
@@ -33,6 +49,9 @@ void board_add_edge_uni (board_vertex * source, board_vertex * destination)
     realloc (source->neighbors,
              source->degree * sizeof (*(source->neighbors)));
   source->neighbors[source->degree - 1] = destination;
+  source->weights =
+    realloc (source->weights, source->degree * sizeof (*(source->weights)));
+  source->weights[source->degree - 1] = weight;
 }
 
 bool board_read_from (board * self, FILE * file)
@@ -72,25 +91,83 @@ bool board_read_from (board * self, FILE * file)
   for (size_t i = 0; i < edges; i++)
     {
       size_t v1, v2;
+      unsigned int weight = 1;
       if (!fgets (line, sizeof (line), file))
         return false;
-      sscanf (line, "%zu %zu", &v1, &v2);
+      if (sscanf (line, "%zu %zu %u", &v1, &v2, &weight) == 3)
+        {
+          self->weighted = true;
+        }
       if (v1 > self->size - 1 || v2 > self->size - 1)
         {
           return false;
         }
-      board_add_edge_uni (self->vertices[v1], self->vertices[v2]);
-      board_add_edge_uni (self->vertices[v2], self->vertices[v1]);
+      if (weight == 0 || weight > BOARD_MAX_WEIGHT)
+        {
+          return false;
+        }
+      board_add_edge_uni (self->vertices[v1], self->vertices[v2], weight);
+      board_add_edge_uni (self->vertices[v2], self->vertices[v1], weight);
     }
+  board_label_components (self);
+  board_reorder (self);
   board_Floyd_Warshall (self);
   return true;
 }
 
+/*
+ * Auxiliary function to hash one value byte by byte
+ */
+uint64_t board_hash_value (uint64_t hash, uint64_t value)
+{
+  for (size_t i = 0; i < sizeof (value); i++)
+    {
+      hash ^= (value >> (8 * i)) & 0xff;
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+uint64_t board_hash (board * self)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  if (self == NULL)
+    {
+      return hash;
+    }
+
+  hash = board_hash_value (hash, self->size);
+  hash = board_hash_value (hash, self->cops);
+  hash = board_hash_value (hash, self->robbers);
+  hash = board_hash_value (hash, self->max_turn);
+  for (size_t u = 0; u < self->size; u++)
+    {
+      board_vertex *vertex = self->vertices[u];
+      hash = board_hash_value (hash, vertex->degree);
+      for (size_t i = 0; i < vertex->degree; i++)
+        {
+          hash = board_hash_value (hash, vertex->neighbors[i]->index);
+        }
+    }
+  // Weights only change the hash of weighted boards
+  for (size_t u = 0; u < self->size && self->weighted; u++)
+    {
+      board_vertex *vertex = self->vertices[u];
+      for (size_t i = 0; i < vertex->degree; i++)
+        {
+          hash = board_hash_value (hash, vertex->weights[i]);
+        }
+    }
+  return hash;
+}
+
 void board_vertex_destroy (board_vertex * self)
 {
   free (self->neighbors);
+  free (self->weights);
   free (self->optim);
   self->neighbors = NULL;
+  self->weights = NULL;
   self->optim = NULL;
 }
 
@@ -105,21 +182,37 @@ void board_destroy (board * self)
     {
       board_vertex_destroy (self->vertices[i]);
       free (self->vertices[i]);
+    }
+  for (size_t c = 0; c < self->components; c++)
+    {
       if (self->dist != NULL)
         {
-          free (self->dist[i]);
+          free (self->dist[c]);
         }
       if (self->next != NULL)
         {
-          free (self->next[i]);
+          free (self->next[c]);
         }
     }
   free (self->dist);
   free (self->next);
   free (self->vertices);
+  free (self->component);
+  free (self->local);
+  free (self->members);
+  free (self->offset);
+  free (self->neighborhoods);
   self->dist = NULL;
   self->next = NULL;
   self->vertices = NULL;
+  self->component = NULL;
+  self->local = NULL;
+  self->members = NULL;
+  self->offset = NULL;
+  self->neighborhoods = NULL;
+  self->words = 0;
+  self->components = 0;
+  self->weighted = false;
 }
 
 bool board_is_valid_move (board * self, size_t source, size_t dest)
@@ -144,10 +237,10 @@ bool board_is_valid_move (board * self, size_t source, size_t dest)
       return false;
     }
 
-  for (size_t i = 0; i < self->size; i++)
+  board_vertex *vertex = self->vertices[source];
+  for (size_t i = 0; i < vertex->degree; i++)
     {
-      if (self->vertices[i]->degree > dest
-          && self->vertices[i]->neighbors[dest] != NULL)
+      if (vertex->neighbors[i]->index == dest)
         {
           return true;
         }
@@ -155,57 +248,440 @@ bool board_is_valid_move (board * self, size_t source, size_t dest)
   return false;
 }
 
-void board_Floyd_Warshall (board * self)
+void board_label_components (board * self)
 {
   if (self == NULL)
     {
       return;
     }
 
-  self->dist = calloc (self->size, sizeof (unsigned int *));
-  self->next = calloc (self->size, sizeof (size_t *));
-  for (size_t i = 0; i < self->size; i++)
+  self->component = calloc (self->size, sizeof (*self->component));
+  self->local = calloc (self->size, sizeof (*self->local));
+  self->members = calloc (self->size, sizeof (*self->members));
+  self->offset = calloc (self->size + 1, sizeof (*self->offset));
+  self->components = 0;
+
+  // Depth-first search from each unlabeled vertex, members is used as
+  // the stack since it is filled again afterwards
+  bool *seen = calloc (self->size, sizeof (*seen));
+  for (size_t s = 0; s < self->size; s++)
+    {
+      if (seen[s])
+        {
+          continue;
+        }
+      size_t top = 0;
+      self->members[top++] = s;
+      seen[s] = true;
+      while (top > 0)
+        {
+          board_vertex *vertex = self->vertices[self->members[--top]];
+          self->component[vertex->index] = self->components;
+          for (size_t i = 0; i < vertex->degree; i++)
+            {
+              size_t v = vertex->neighbors[i]->index;
+              if (!seen[v])
+                {
+                  seen[v] = true;
+                  self->members[top++] = v;
+                }
+            }
+        }
+      self->components++;
+    }
+  free (seen);
+
+  // Group vertices by component, keeping increasing order inside each
+  // component so that local order matches global order
+  for (size_t v = 0; v < self->size; v++)
+    {
+      self->offset[self->component[v] + 1]++;
+    }
+  for (size_t c = 0; c < self->components; c++)
     {
-      self->dist[i] = calloc (self->size, sizeof (unsigned int));
-      self->next[i] = calloc (self->size, sizeof (size_t));
+      self->offset[c + 1] += self->offset[c];
     }
+  size_t *fill = calloc (self->components, sizeof (*fill));
+  for (size_t v = 0; v < self->size; v++)
+    {
+      size_t c = self->component[v];
+      self->local[v] = fill[c]++;
+      self->members[self->offset[c] + self->local[v]] = v;
+    }
+  free (fill);
+}
 
-  for (size_t u = 0; u < self->size; u++)
+void board_reorder (board * self)
+{
+  if (self == NULL || self->members == NULL
+      || self->order == BOARD_ORDER_FILE)
+    {
+      return;
+    }
+
+  bool *seen = calloc (self->size, sizeof (*seen));
+  for (size_t c = 0; c < self->components; c++)
     {
-      for (size_t v = 0; v < self->size; v++)
+      size_t n = self->offset[c + 1] - self->offset[c];
+      size_t *members = self->members + self->offset[c];
+      // Start from a vertex of smallest degree, likely on the border
+      size_t start = members[0];
+      for (size_t u = 1; u < n; u++)
+        {
+          if (self->vertices[members[u]]->degree <
+              self->vertices[start]->degree)
+            {
+              start = members[u];
+            }
+        }
+      // Breadth-first search in place, the queue being members itself
+      size_t head = 0, tail = 0;
+      members[tail++] = start;
+      seen[start] = true;
+      while (head < tail)
+        {
+          board_vertex *vertex = self->vertices[members[head++]];
+          size_t first = tail;
+          for (size_t i = 0; i < vertex->degree; i++)
+            {
+              size_t v = vertex->neighbors[i]->index;
+              if (seen[v])
+                {
+                  continue;
+                }
+              seen[v] = true;
+              members[tail++] = v;
+              // Cuthill-McKee enqueues neighbors by increasing degree
+              for (size_t k = tail - 1; self->order == BOARD_ORDER_RCM
+                   && k > first && self->vertices[members[k - 1]]->degree
+                   > self->vertices[v]->degree; k--)
+                {
+                  members[k] = members[k - 1];
+                  members[k - 1] = v;
+                }
+            }
+        }
+      for (size_t u = 0; self->order == BOARD_ORDER_RCM && u < n / 2; u++)
         {
-          self->dist[u][v] = INT_MAX;
-          self->next[u][v] = 0;
+          size_t v = members[u];
+          members[u] = members[n - 1 - u];
+          members[n - 1 - u] = v;
         }
+      for (size_t u = 0; u < n; u++)
+        {
+          self->local[members[u]] = u;
+        }
+    }
+  free (seen);
+}
+
+void board_neighborhoods (board * self)
+{
+  if (self == NULL || self->size > BOARD_BITBOARD_MAX
+      || self->neighborhoods != NULL)
+    {
+      return;
     }
 
+  self->words = (self->size + 63) / 64;
+  self->neighborhoods = calloc (self->size * self->words, sizeof (uint64_t));
   for (size_t u = 0; u < self->size; u++)
     {
+      uint64_t *row = self->neighborhoods + u * self->words;
       board_vertex *vertex = self->vertices[u];
+      row[u / 64] |= (uint64_t) 1 << (u % 64);
       for (size_t i = 0; i < vertex->degree; i++)
         {
           size_t v = vertex->neighbors[i]->index;
-          self->dist[u][v] = 1;
-          self->next[u][v] = v;
+          row[v / 64] |= (uint64_t) 1 << (v % 64);
         }
     }
+}
 
-  for (size_t v = 0; v < self->size; v++)
+void board_expand (board * self, vertex_set * set, size_t k)
+{
+  if (self == NULL || set == NULL || set->size != self->size)
+    {
+      return;
+    }
+  if (self->neighborhoods == NULL && self->words == 0)
+    {
+      board_neighborhoods (self);
+    }
+
+  // Only vertices added by the previous step need to be expanded
+  vertex_set frontier, previous;
+  vertex_set_create (&frontier, set->size);
+  vertex_set_create (&previous, set->size);
+  vertex_set_copy (&frontier, set);
+  for (size_t step = 0; step < k; step++)
+    {
+      vertex_set_copy (&previous, set);
+      for (size_t w = 0; w < set->words; w++)
+        {
+          uint64_t word = frontier.bits[w];
+          while (word != 0)
+            {
+              size_t u = w * 64 + __builtin_ctzll (word);
+              word &= word - 1;
+              if (self->neighborhoods != NULL)
+                {
+                  // Word-parallel union with the bitboard of u
+                  const uint64_t *row = self->neighborhoods + u * self->words;
+                  for (size_t i = 0; i < set->words; i++)
+                    {
+                      set->bits[i] |= row[i];
+                    }
+                }
+              else
+                {
+                  board_vertex *vertex = self->vertices[u];
+                  for (size_t i = 0; i < vertex->degree; i++)
+                    {
+                      vertex_set_add (set, vertex->neighbors[i]->index);
+                    }
+                }
+            }
+        }
+      vertex_set_copy (&frontier, set);
+      vertex_set_difference (&frontier, &previous);
+    }
+  vertex_set_destroy (&frontier);
+  vertex_set_destroy (&previous);
+}
+
+/*
+ * Relax the tile of rows [u0, u1) and columns [v0, v1) through the
+ * intermediate vertices [w0, w1). Updates are branchless on 32-bit
+ * lanes so that the inner loop is vectorized.
+ */
+static void board_relax_tile (unsigned int *restrict dist,
+                              uint32_t * restrict next, size_t n, size_t u0,
+                              size_t u1, size_t v0, size_t v1, size_t w0,
+                              size_t w1)
+{
+  for (size_t w = w0; w < w1; w++)
+    {
+      const unsigned int *dw = dist + w * n;
+      for (size_t u = u0; u < u1; u++)
+        {
+          unsigned int *du = dist + u * n;
+          uint32_t *nu = next + u * n;
+          unsigned int uw = du[w];
+          uint32_t hop = nu[w];
+          for (size_t v = v0; v < v1; v++)
+            {
+              unsigned int candidate = uw + dw[v];
+              unsigned int better = candidate < du[v];
+              du[v] = better ? candidate : du[v];
+              nu[v] = better ? hop : nu[v];
+            }
+        }
+    }
+}
+
+typedef struct
+{
+  unsigned int *dist;
+  uint32_t *next;
+  size_t n;
+  size_t k;
+  size_t tiles;
+  size_t phase;
+  size_t thread;
+  size_t threads;
+} board_tile_job;
+
+/*
+ * Relax the tiles of one phase of round k assigned to a thread: phase
+ * 2 updates the tiles of row and column k, phase 3 every other tile
+ */
+static void *board_run_tiles (void *arg)
+{
+  board_tile_job *job = arg;
+  size_t n = job->n;
+  size_t k0 = job->k * BOARD_TILE;
+  size_t k1 = k0 + BOARD_TILE < n ? k0 + BOARD_TILE : n;
+  size_t count = job->phase == 2 ? 2 * job->tiles : job->tiles * job->tiles;
+  for (size_t t = job->thread; t < count; t += job->threads)
+    {
+      size_t i, j;
+      if (job->phase == 2)
+        {
+          i = t < job->tiles ? job->k : t - job->tiles;
+          j = t < job->tiles ? t : job->k;
+        }
+      else
+        {
+          i = t / job->tiles;
+          j = t % job->tiles;
+        }
+      if ((i == job->k) + (j == job->k) != (job->phase == 2 ? 1 : 0))
+        {
+          continue;
+        }
+      size_t u0 = i * BOARD_TILE, v0 = j * BOARD_TILE;
+      size_t u1 = u0 + BOARD_TILE < n ? u0 + BOARD_TILE : n;
+      size_t v1 = v0 + BOARD_TILE < n ? v0 + BOARD_TILE : n;
+      board_relax_tile (job->dist, job->next, n, u0, u1, v0, v1, k0, k1);
+    }
+  return NULL;
+}
+
+void board_Floyd_Warshall_blocked (unsigned int *dist, uint32_t * next,
+                                   size_t n, size_t threads)
+{
+  size_t tiles = (n + BOARD_TILE - 1) / BOARD_TILE;
+  if (threads == 0)
+    {
+      long online = sysconf (_SC_NPROCESSORS_ONLN);
+      threads = online > 0 ? (size_t) online : 1;
+    }
+  // Small matrices are not worth starting threads
+  if (tiles < 4)
     {
-      self->dist[v][v] = 0;
-      self->next[v][v] = v;
+      threads = 1;
     }
+  pthread_t *ids = calloc (threads, sizeof (*ids));
+  bool *started = calloc (threads, sizeof (*started));
+  board_tile_job *jobs = calloc (threads, sizeof (*jobs));
+
+  for (size_t k = 0; k < tiles; k++)
+    {
+      // Phase 1: the diagonal tile only depends on itself
+      size_t k0 = k * BOARD_TILE;
+      size_t k1 = k0 + BOARD_TILE < n ? k0 + BOARD_TILE : n;
+      board_relax_tile (dist, next, n, k0, k1, k0, k1, k0, k1);
+
+      for (size_t phase = 2; phase <= 3; phase++)
+        {
+          for (size_t t = 0; t < threads; t++)
+            {
+              jobs[t].dist = dist;
+              jobs[t].next = next;
+              jobs[t].n = n;
+              jobs[t].k = k;
+              jobs[t].tiles = tiles;
+              jobs[t].phase = phase;
+              jobs[t].thread = t;
+              jobs[t].threads = threads;
+              started[t] = t + 1 < threads
+                && pthread_create (&ids[t], NULL, board_run_tiles,
+                                   &jobs[t]) == 0;
+              if (!started[t])
+                {
+                  board_run_tiles (&jobs[t]);
+                }
+            }
+          for (size_t t = 0; t < threads; t++)
+            {
+              if (started[t])
+                {
+                  pthread_join (ids[t], NULL);
+                }
+            }
+        }
+    }
+  free (ids);
+  free (started);
+  free (jobs);
+}
+
+/*
+ * Compute distances of a weighted component with the blocked
+ * algorithm on local next indices, then store global indices
+ */
+static void board_Floyd_Warshall_weighted (board * self, size_t c)
+{
+  size_t n = self->offset[c + 1] - self->offset[c];
+  size_t *members = self->members + self->offset[c];
+  unsigned int *dist = self->dist[c];
+  uint32_t *local = calloc (n * n, sizeof (uint32_t));
 
-  for (size_t w = 0; w < self->size; w++)
+  for (size_t u = 0; u < n; u++)
     {
-      for (size_t u = 0; u < self->size; u++)
+      board_vertex *vertex = self->vertices[members[u]];
+      for (size_t i = 0; i < vertex->degree; i++)
+        {
+          size_t v = self->local[vertex->neighbors[i]->index];
+          if (vertex->weights[i] < dist[u * n + v])
+            {
+              dist[u * n + v] = vertex->weights[i];
+              local[u * n + v] = v;
+            }
+        }
+      dist[u * n + u] = 0;
+      local[u * n + u] = u;
+    }
+
+  board_Floyd_Warshall_blocked (dist, local, n, 0);
+
+  for (size_t u = 0; u < n * n; u++)
+    {
+      self->next[c][u] = members[local[u]];
+    }
+  free (local);
+}
+
+void board_Floyd_Warshall (board * self)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+
+  self->dist = calloc (self->components, sizeof (unsigned int *));
+  self->next = calloc (self->components, sizeof (size_t *));
+
+  for (size_t c = 0; c < self->components; c++)
+    {
+      size_t n = self->offset[c + 1] - self->offset[c];
+      size_t *members = self->members + self->offset[c];
+      unsigned int *dist = calloc (n * n, sizeof (unsigned int));
+      size_t *next = calloc (n * n, sizeof (size_t));
+      self->dist[c] = dist;
+      self->next[c] = next;
+
+      for (size_t u = 0; u < n * n; u++)
+        {
+          dist[u] = INT_MAX;
+        }
+
+      if (self->weighted)
+        {
+          board_Floyd_Warshall_weighted (self, c);
+          continue;
+        }
+
+      for (size_t u = 0; u < n; u++)
+        {
+          board_vertex *vertex = self->vertices[members[u]];
+          for (size_t i = 0; i < vertex->degree; i++)
+            {
+              size_t v = vertex->neighbors[i]->index;
+              dist[u * n + self->local[v]] = 1;
+              next[u * n + self->local[v]] = v;
+            }
+        }
+
+      for (size_t v = 0; v < n; v++)
+        {
+          dist[v * n + v] = 0;
+          next[v * n + v] = members[v];
+        }
+
+      for (size_t w = 0; w < n; w++)
         {
-          for (size_t v = 0; v < self->size; v++)
+          for (size_t u = 0; u < n; u++)
             {
-              if (self->dist[u][v] > self->dist[u][w] + self->dist[w][v])
+              unsigned int uw = dist[u * n + w];
+              for (size_t v = 0; v < n; v++)
                 {
-                  self->dist[u][v] = self->dist[u][w] + self->dist[w][v];
-                  self->next[u][v] = self->next[u][w];
+                  if (dist[u * n + v] > uw + dist[w * n + v])
+                    {
+                      dist[u * n + v] = uw + dist[w * n + v];
+                      next[u * n + v] = next[u * n + w];
+                    }
                 }
             }
         }
@@ -234,7 +710,14 @@ size_t board_dist (board * self, size_t source, size_t dest)
       return 0;
     }
 
-  return self->dist[source][dest];
+  size_t c = self->component[source];
+  if (c != self->component[dest])
+    {
+      return BOARD_UNREACHABLE;
+    }
+
+  size_t n = self->offset[c + 1] - self->offset[c];
+  return self->dist[c][self->local[source] * n + self->local[dest]];
 }
 
 size_t board_next (board * self, size_t source, size_t dest)
@@ -264,5 +747,92 @@ size_t board_next (board * self, size_t source, size_t dest)
       return 0;
     }
 
-  return self->next[source][dest];
+  size_t c = self->component[source];
+  if (c != self->component[dest])
+    {
+      return source;
+    }
+
+  size_t n = self->offset[c + 1] - self->offset[c];
+  return self->next[c][self->local[source] * n + self->local[dest]];
+}
+
+void vertex_set_create (vertex_set * self, size_t size)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  self->size = size;
+  self->words = (size + 63) / 64;
+  self->bits = calloc (self->words + 1, sizeof (uint64_t));
+}
+
+void vertex_set_destroy (vertex_set * self)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  free (self->bits);
+  self->bits = NULL;
+  self->size = 0;
+  self->words = 0;
+}
+
+void vertex_set_clear (vertex_set * self)
+{
+  memset (self->bits, 0, self->words * sizeof (uint64_t));
+}
+
+void vertex_set_add (vertex_set * self, size_t v)
+{
+  if (v < self->size)
+    {
+      self->bits[v / 64] |= (uint64_t) 1 << (v % 64);
+    }
+}
+
+bool vertex_set_contains (vertex_set * self, size_t v)
+{
+  return v < self->size && ((self->bits[v / 64] >> (v % 64)) & 1);
+}
+
+void vertex_set_copy (vertex_set * self, vertex_set * other)
+{
+  memcpy (self->bits, other->bits, self->words * sizeof (uint64_t));
+}
+
+void vertex_set_union (vertex_set * self, vertex_set * other)
+{
+  for (size_t i = 0; i < self->words; i++)
+    {
+      self->bits[i] |= other->bits[i];
+    }
+}
+
+void vertex_set_intersection (vertex_set * self, vertex_set * other)
+{
+  for (size_t i = 0; i < self->words; i++)
+    {
+      self->bits[i] &= other->bits[i];
+    }
+}
+
+void vertex_set_difference (vertex_set * self, vertex_set * other)
+{
+  for (size_t i = 0; i < self->words; i++)
+    {
+      self->bits[i] &= ~other->bits[i];
+    }
+}
+
+size_t vertex_set_count (vertex_set * self)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < self->words; i++)
+    {
+      count += __builtin_popcountll (self->bits[i]);
+    }
+  return count;
 }
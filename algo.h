@@ -2,16 +2,56 @@
 #define ALGO_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <limits.h>
+
+/*
+ * Distance returned between vertices of different components
+ */
+#define BOARD_UNREACHABLE INT_MAX
+
+/*
+ * Largest edge weight accepted in board files
+ */
+#define BOARD_MAX_WEIGHT 65535
+
+/*
+ * Side of the square tiles of the blocked Floyd-Warshall algorithm
+ */
+#define BOARD_TILE 64
+
+/*
+ * Largest board for which closed neighborhood bitboards are stored
+ */
+#define BOARD_BITBOARD_MAX 16384
+
+/*
+ * Set of vertices stored as one bit per vertex
+ */
+typedef struct
+{
+  size_t size;
+  size_t words;
+  uint64_t *bits;
+} vertex_set;
 
 enum role
 { COPS, ROBBERS };
 
+/*
+ * Order of the vertices of each component in distance blocks: file
+ * order, breadth-first order or reverse Cuthill-McKee order
+ */
+enum board_order
+{ BOARD_ORDER_FILE, BOARD_ORDER_BFS, BOARD_ORDER_RCM };
+
 typedef struct sboard_vertex
 {
   size_t index;
   size_t degree;
   struct sboard_vertex **neighbors;
+  unsigned int *weights;
   bool *optim;
 } board_vertex;
 
@@ -22,8 +62,17 @@ typedef struct
   size_t cops;
   size_t robbers;
   size_t max_turn;
+  bool weighted;
+  enum board_order order;
+  size_t components;
+  size_t *component;
+  size_t *local;
+  size_t *members;
+  size_t *offset;
   unsigned int **dist;
   size_t **next;
+  size_t words;
+  uint64_t *neighborhoods;
 } board;
 
 /*
@@ -33,10 +82,18 @@ void board_create (board * self);
 
 /*
  * Create board from parsing a file and return false if file is
- * incorrect
+ * incorrect, edges are "source dest" or "source dest weight" lines
+ * and the board is weighted if any edge has a weight. Vertices keep
+ * their file index, order only changes the layout of distances.
  */
 bool board_read_from (board * self, FILE * file);
 
+/*
+ * Return a 64-bit FNV-1a hash of the board parameters and adjacency
+ * lists, used to check that stored data matches a board
+ */
+uint64_t board_hash (board * self);
+
 /*
  * Destroy a board by freeing all memory used by its members
  */
@@ -47,22 +104,112 @@ void board_destroy (board * self);
  */
 bool board_is_valid_move (board * self, size_t source, size_t dest);
 
+/*
+ * Label connected components: component[v] is the component of v,
+ * members lists vertices grouped by component in increasing order,
+ * offset[c] is the position of the first member of c and local[v] is
+ * the position of v inside its component
+ */
+void board_label_components (board * self);
+
+/*
+ * Renumber the local indices of each component following order so
+ * that neighbors get close rows in dist and next, members and local
+ * being the permutation between file and local indices
+ */
+void board_reorder (board * self);
+
+/*
+ * Compute the closed neighborhood bitboard of each vertex, the one of
+ * v being the words words starting at neighborhoods + v * words, if
+ * not built yet. The first board_expand calls it without locking, so
+ * it must be called before sharing a board between threads.
+ */
+void board_neighborhoods (board * self);
+
+/*
+ * Replace set by the vertices reachable from it in at most k moves,
+ * set being left unchanged if it is not a set of vertices of the board
+ */
+void board_expand (board * self, vertex_set * set, size_t k);
+
 /*
  * Floyd-Warshall algorithm to determine the smallest number of edges
- * from any vertex to any other vertex
+ * (or total weight on weighted boards) from any vertex to any other
+ * vertex of the same component, dist[c] and next[c] are flat blocks
+ * of size c * c indexed by local indices
  */
 void board_Floyd_Warshall (board * self);
 
 /*
- * Return shortest number of edges between vertex source and vertex
- * dest
+ * Tiled Floyd-Warshall over the flat n * n matrices dist and next
+ * (next holding local indices), tiles of each phase being shared
+ * between threads threads (0 for one per online processor)
+ */
+void board_Floyd_Warshall_blocked (unsigned int *dist, uint32_t * next,
+                                   size_t n, size_t threads);
+
+/*
+ * Return shortest number of edges (or total weight) between vertex
+ * source and vertex dest (BOARD_UNREACHABLE if they are in different
+ * components)
  */
 size_t board_dist (board * self, size_t source, size_t dest);
 
 /*
  * Return next vertex on shortest path from vertex source to vertex
- * dest
+ * dest (source if dest is unreachable)
  */
 size_t board_next (board * self, size_t source, size_t dest);
 
+/*
+ * Create an empty set of vertices among size vertices
+ */
+void vertex_set_create (vertex_set * self, size_t size);
+
+/*
+ * Destroy a set by freeing its bits
+ */
+void vertex_set_destroy (vertex_set * self);
+
+/*
+ * Remove every vertex from the set
+ */
+void vertex_set_clear (vertex_set * self);
+
+/*
+ * Add vertex v to the set
+ */
+void vertex_set_add (vertex_set * self, size_t v);
+
+/*
+ * Check if vertex v is in the set
+ */
+bool vertex_set_contains (vertex_set * self, size_t v);
+
+/*
+ * Replace self by other, both sets having the same size
+ */
+void vertex_set_copy (vertex_set * self, vertex_set * other);
+
+/*
+ * Add every vertex of other to self
+ */
+void vertex_set_union (vertex_set * self, vertex_set * other);
+
+/*
+ * Keep only vertices of self that are in other
+ */
+void vertex_set_intersection (vertex_set * self, vertex_set * other);
+
+/*
+ * Remove vertices of other from self
+ */
+void vertex_set_difference (vertex_set * self, vertex_set * other);
+
+/*
+ * Return the number of vertices in the set
+ */
+size_t vertex_set_count (vertex_set * self);
+
 #endif // ALGO_H
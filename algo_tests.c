@@ -1,7 +1,13 @@
 #include "algo.h"
+#include "assignment.h"
+#include "mcts.h"
+#include "pieces.h"
+#include "tablebase.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 
 #define mu_assert(message, test) do { if (!(test)) return message; } while (0)
@@ -39,7 +45,7 @@ void print_board_distances (board * self)
     {
       for (size_t j = 0; j < self->size; j++)
         {
-          printf ("%d ", self->dist[i][j]);
+          printf ("%zu ", board_dist (self, i, j));
         }
       printf ("\n");
     }
@@ -277,6 +283,719 @@ static char *test_board_Floyd_Warshall_square ()
   return NULL;
 }
 
+static char *test_board_label_components_disconnected ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\n"
+    "Vertices: 5\n0 0\n0 0\n0 0\n0 0\n0 0\n" "Edges: 2\n0 3\n3 4\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, incorrect number of components", b.components == 3);
+  mu_assert ("error, incorrect components", b.component[0] == b.component[4]
+             && b.component[1] != b.component[0]
+             && b.component[2] != b.component[1]);
+  mu_assert ("error, incorrect local indices", b.local[0] == 0
+             && b.local[3] == 1 && b.local[4] == 2 && b.local[1] == 0);
+
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_board_Floyd_Warshall_disconnected ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\n"
+    "Vertices: 5\n0 0\n0 0\n0 0\n0 0\n0 0\n" "Edges: 2\n0 3\n3 4\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, incorrect distance", board_dist (&b, 0, 4) == 2
+             && board_dist (&b, 1, 1) == 0);
+  mu_assert ("error, cross-component distance should be unreachable",
+             board_dist (&b, 0, 1) == BOARD_UNREACHABLE
+             && board_dist (&b, 2, 4) == BOARD_UNREACHABLE);
+  mu_assert ("error, incorrect next vertex", board_next (&b, 0, 4) == 3
+             && board_next (&b, 4, 0) == 3);
+  mu_assert ("error, next vertex toward unreachable vertex should stay",
+             board_next (&b, 3, 2) == 3);
+
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_board_Floyd_Warshall_weighted ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\n"
+    "Vertices: 4\n0 0\n0 0\n0 0\n0 0\n"
+    "Edges: 4\n0 1 1\n1 2 1\n0 2 5\n2 3\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, board should be weighted", b.weighted == true);
+  mu_assert ("error, incorrect weighted distance", board_dist (&b, 0, 2) == 2
+             && board_dist (&b, 0, 3) == 3 && board_dist (&b, 3, 3) == 0);
+  mu_assert ("error, incorrect weighted next vertex",
+             board_next (&b, 0, 2) == 1 && board_next (&b, 3, 0) == 2);
+  mu_assert ("error, edge should still be a valid move",
+             board_is_valid_move (&b, 0, 2) == true);
+
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_board_read_from_invalid_weight ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\n"
+    "Vertices: 2\n0 0\n0 0\n" "Edges: 1\n0 1 0\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+
+  mu_assert ("error, read should be false with null weight", read == false);
+
+  board_destroy (&b);
+  return NULL;
+}
+
+/*
+ * Auxiliary function writing a ring of size vertices with chords, with
+ * or without explicit unit weights
+ */
+static FILE *ring_board (size_t size, bool weights)
+{
+  FILE *file = tmpfile ();
+  fprintf (file, "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: %zu\n", size);
+  for (size_t i = 0; i < size; i++)
+    fprintf (file, "0 0\n");
+  fprintf (file, "Edges: %zu\n", size + size / 7);
+  for (size_t i = 0; i < size; i++)
+    fprintf (file, weights ? "%zu %zu 1\n" : "%zu %zu\n", i, (i + 1) % size);
+  for (size_t i = 0; i < size / 7; i++)
+    fprintf (file, weights ? "%zu %zu 1\n" : "%zu %zu\n", 7 * i,
+             (7 * i * 13 + 5) % size);
+  rewind (file);
+  return file;
+}
+
+static char *test_board_Floyd_Warshall_blocked_unit_weights ()
+{
+  board plain, weighted;
+  board_create (&plain);
+  board_create (&weighted);
+
+  size_t size = 3 * BOARD_TILE + 17;
+  bool read = board_read_from (&plain, ring_board (size, false))
+    && board_read_from (&weighted, ring_board (size, true));
+  bool same = true, consistent = true;
+  for (size_t u = 0; u < size; u++)
+    for (size_t v = 0; v < size; v++)
+      {
+        size_t d = board_dist (&weighted, u, v);
+        same = same && d == board_dist (&plain, u, v);
+        consistent = consistent && (u == v
+                                    || board_dist (&weighted,
+                                                   board_next (&weighted, u,
+                                                               v),
+                                                   v) == d - 1);
+      }
+
+  mu_assert ("error, failure reading boards", read == true);
+  mu_assert ("error, blocked distances differ", same == true);
+  mu_assert ("error, blocked next vertices are not on shortest paths",
+             consistent == true);
+
+  board_destroy (&plain);
+  board_destroy (&weighted);
+  return NULL;
+}
+
+/*
+ * Largest distance between the local indices of adjacent vertices
+ */
+static size_t board_bandwidth (board * b)
+{
+  size_t bandwidth = 0;
+  for (size_t u = 0; u < b->size; u++)
+    for (size_t i = 0; i < b->vertices[u]->degree; i++)
+      {
+        size_t v = b->vertices[u]->neighbors[i]->index;
+        size_t gap = b->local[u] > b->local[v] ? b->local[u] - b->local[v]
+          : b->local[v] - b->local[u];
+        bandwidth = gap > bandwidth ? gap : bandwidth;
+      }
+  return bandwidth;
+}
+
+static char *test_board_reorder ()
+{
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 10\n"
+    "Vertices: 10\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n"
+    "Edges: 8\n0 5\n5 2\n2 7\n7 1\n1 6\n6 3\n3 4\n8 9\n";
+  enum board_order orders[] = { BOARD_ORDER_FILE, BOARD_ORDER_BFS,
+    BOARD_ORDER_RCM
+  };
+  board b[3];
+  bool read = true;
+  for (size_t k = 0; k < 3; k++)
+    {
+      board_create (&b[k]);
+      b[k].order = orders[k];
+      FILE *file = tmpfile ();
+      fputs (data, file);
+      rewind (file);
+      read = read && board_read_from (&b[k], file);
+      fclose (file);
+    }
+
+  bool same = true, shortest = true, permutation = true;
+  for (size_t k = 1; k < 3 && read; k++)
+    {
+      for (size_t u = 0; u < 10; u++)
+        {
+          size_t c = b[k].component[u];
+          permutation = permutation
+            && b[k].members[b[k].offset[c] + b[k].local[u]] == u;
+          for (size_t v = 0; v < 10; v++)
+            {
+              size_t d = board_dist (&b[k], u, v);
+              same = same && d == board_dist (&b[0], u, v);
+              if (u != v && d != BOARD_UNREACHABLE)
+                shortest = shortest
+                  && board_is_valid_move (&b[k], u, board_next (&b[k], u, v))
+                  && board_dist (&b[k], board_next (&b[k], u, v), v) == d - 1;
+            }
+        }
+    }
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, members and local should stay inverse", permutation);
+  mu_assert ("error, reordering should keep distances", same);
+  mu_assert ("error, reordering should keep shortest next vertices",
+             shortest);
+  mu_assert ("error, path in file order should have a large bandwidth",
+             board_bandwidth (&b[0]) > 1);
+  mu_assert ("error, path should have bandwidth 1 once reordered",
+             board_bandwidth (&b[1]) == 1 && board_bandwidth (&b[2]) == 1);
+
+  for (size_t k = 0; k < 3; k++)
+    board_destroy (&b[k]);
+  return NULL;
+}
+
+static char *test_vertex_set_operations ()
+{
+  vertex_set a, b;
+  vertex_set_create (&a, 130);
+  vertex_set_create (&b, 130);
+  vertex_set_add (&a, 0);
+  vertex_set_add (&a, 64);
+  vertex_set_add (&a, 129);
+  vertex_set_add (&b, 64);
+  vertex_set_add (&b, 100);
+  vertex_set_add (&b, 130);
+
+  mu_assert ("error, incorrect membership", vertex_set_contains (&a, 129)
+             && !vertex_set_contains (&a, 1)
+             && !vertex_set_contains (&b, 130));
+  mu_assert ("error, incorrect count", vertex_set_count (&a) == 3
+             && vertex_set_count (&b) == 2);
+  vertex_set_union (&a, &b);
+  mu_assert ("error, incorrect union", vertex_set_count (&a) == 4
+             && vertex_set_contains (&a, 100));
+  vertex_set_difference (&a, &b);
+  mu_assert ("error, incorrect difference", vertex_set_count (&a) == 2
+             && !vertex_set_contains (&a, 64));
+  vertex_set_add (&a, 100);
+  vertex_set_intersection (&a, &b);
+  mu_assert ("error, incorrect intersection", vertex_set_count (&a) == 1
+             && vertex_set_contains (&a, 100));
+  vertex_set_clear (&a);
+  mu_assert ("error, incorrect clear", vertex_set_count (&a) == 0);
+
+  vertex_set_destroy (&a);
+  vertex_set_destroy (&b);
+  return NULL;
+}
+
+static char *test_board_expand ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\n"
+    "Vertices: 6\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n"
+    "Edges: 4\n0 1\n1 2\n2 3\n4 5\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  bool eager = b.neighborhoods != NULL;
+  vertex_set reach;
+  vertex_set_create (&reach, b.size);
+  vertex_set_add (&reach, 0);
+  board_expand (&b, &reach, 2);
+  bool expanded = vertex_set_count (&reach) == 3
+    && vertex_set_contains (&reach, 2) && !vertex_set_contains (&reach, 3);
+
+  bool lazy = b.neighborhoods != NULL;
+
+  // Same expansion walking adjacency lists, as on boards too big for
+  // bitboards
+  free (b.neighborhoods);
+  b.neighborhoods = NULL;
+  vertex_set_clear (&reach);
+  vertex_set_add (&reach, 0);
+  vertex_set_add (&reach, 5);
+  board_expand (&b, &reach, 5);
+  bool walked = vertex_set_count (&reach) == 6;
+  vertex_set larger;
+  vertex_set_create (&larger, b.size + 64);
+  vertex_set_add (&larger, b.size + 1);
+  board_expand (&b, &larger, 1);
+  bool checked = vertex_set_count (&larger) == 1;
+  vertex_set_destroy (&larger);
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, incorrect expansion with bitboards", expanded == true);
+  mu_assert ("error, incorrect expansion without bitboards", walked == true);
+  mu_assert ("error, bitboards should be built by the first expansion",
+             eager == false && lazy == true);
+  mu_assert ("error, sets of another size should be left unchanged",
+             checked == true);
+
+  vertex_set_destroy (&reach);
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_tablebase_solve_chain ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 10\n"
+    "Vertices: 3\n0 0\n0 0\n0 0\n" "Edges: 2\n0 1\n1 2\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  tablebase tb;
+  tablebase_create (&tb);
+  bool solved = tablebase_solve (&tb, &b, 2);
+  size_t cop[] = { 0 };
+  size_t middle[] = { 1 };
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, failure solving board", solved == true);
+  mu_assert ("error, incorrect number of states", tb.states == 9);
+  mu_assert ("error, incorrect distance to capture when captured",
+             tablebase_cops_dtc (&tb, cop, 0) == 0
+             && tablebase_robbers_dtc (&tb, cop, 0) == 0);
+  mu_assert ("error, incorrect distance to capture for cops",
+             tablebase_cops_dtc (&tb, cop, 2) == 3
+             && tablebase_cops_dtc (&tb, middle, 2) == 1);
+  mu_assert ("error, incorrect distance to capture for robbers",
+             tablebase_robbers_dtc (&tb, middle, 2) == 2
+             && tablebase_robbers_dtc (&tb, cop, 1) == 4);
+
+  tablebase_destroy (&tb);
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_tablebase_solve_disconnected ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 10\n"
+    "Vertices: 3\n0 0\n0 0\n0 0\n" "Edges: 1\n0 1\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  tablebase tb;
+  tablebase_create (&tb);
+  bool solved = tablebase_solve (&tb, &b, 1);
+  size_t cop[] = { 0 };
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, failure solving board", solved == true);
+  mu_assert ("error, robber in another component should survive",
+             tablebase_cops_dtc (&tb, cop, 2) == TABLEBASE_LOST);
+  mu_assert ("error, robber next to the cop should be captured",
+             tablebase_cops_dtc (&tb, cop, 1) == 1);
+
+  tablebase_destroy (&tb);
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_tablebase_write_load ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 2\nRobbers: 1\nMax turn: 10\n"
+    "Vertices: 4\n0 0\n0 0\n0 0\n0 0\n" "Edges: 4\n0 1\n1 2\n2 3\n3 0\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  tablebase solved, loaded;
+  tablebase_create (&solved);
+  tablebase_create (&loaded);
+  tablebase_solve (&solved, &b, 0);
+  bool written = tablebase_write (&solved, &b, "algo_tests.tb");
+  bool mapped = tablebase_load (&loaded, &b, "algo_tests.tb");
+  remove ("algo_tests.tb");
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, failure writing tablebase", written == true);
+  mu_assert ("error, failure loading tablebase", mapped == true);
+  mu_assert ("error, loaded tablebase differs",
+             loaded.states == solved.states
+             && memcmp (loaded.cops_dtc, solved.cops_dtc, solved.states) == 0
+             && memcmp (loaded.robbers_dtc, solved.robbers_dtc,
+                        solved.states) == 0);
+
+  tablebase_destroy (&solved);
+  tablebase_destroy (&loaded);
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_mcts_policy_chase ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 10\n"
+    "Vertices: 4\n0 0\n0 0\n0 0\n0 0\n" "Edges: 3\n0 1\n1 2\n2 3\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  size_t cops[] = { 0 };
+  size_t robbers[] = { 2 };
+  size_t move[1];
+  uint64_t seed = 42;
+  mcts_position position = { &b, 1, cops, 1, robbers, COPS, 10, NULL };
+  mcts_policy (&position, 1, &seed, move);
+  size_t cop_move = move[0];
+  position.turn = ROBBERS;
+  mcts_policy (&position, 1, &seed, move);
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, greedy cop should move toward the robber",
+             cop_move == 1);
+  mu_assert ("error, greedy robber should move away from the cop",
+             move[0] == 3);
+
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_mcts_search_capture ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 2\nRobbers: 1\nMax turn: 10\n"
+    "Vertices: 5\n0 0\n0 0\n0 0\n0 0\n0 0\n"
+    "Edges: 5\n0 1\n1 2\n2 3\n3 4\n4 0\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  size_t cops[] = { 0, 3 };
+  size_t robbers[] = { 4 };
+  size_t move[2];
+  mcts_stats stats;
+  mcts_position position = { &b, 2, cops, 1, robbers, COPS, 4, NULL };
+  mcts_search (&position, 0.05, 2, move, &stats);
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, search should run playouts", stats.playouts > 0
+             && stats.threads == 2);
+  mu_assert ("error, search should capture the adjacent robber",
+             move[0] == 4 || move[1] == 4);
+  mu_assert ("error, searched moves should be valid",
+             board_is_valid_move (&b, 0, move[0])
+             && board_is_valid_move (&b, 3, move[1]));
+
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_trace_write ()
+{
+  remove ("algo_tests.trace");
+  trace *t = calloc (1, sizeof (*t));
+  bool opened = trace_open (t, "algo_tests.trace", TRACE_WRITER_COPS);
+  uint32_t positions[] = { 4, 2, 7 };
+  trace_write (t, TRACE_MOVE, COPS, 3, 1500, positions, 3);
+  trace_close (t);
+  // A second writer appends after the records without another header
+  bool reopened = trace_open (t, "algo_tests.trace", TRACE_WRITER_ROBBERS);
+  trace_write (t, TRACE_MOVE, ROBBERS, 3, 0, positions, 1);
+  trace_close (t);
+  free (t);
+
+  FILE *file = fopen ("algo_tests.trace", "rb");
+  uint32_t header[2];
+  trace_record record, appended;
+  uint32_t words[3], word;
+  bool read = file != NULL && fread (header, sizeof (header), 1, file) == 1
+    && fread (&record, sizeof (record), 1, file) == 1
+    && fread (words, sizeof (words), 1, file) == 1
+    && fread (&appended, sizeof (appended), 1, file) == 1
+    && fread (&word, sizeof (word), 1, file) == 1;
+  if (file != NULL)
+    fclose (file);
+  remove ("algo_tests.trace");
+
+  mu_assert ("error, failure opening trace", opened == true);
+  mu_assert ("error, failure reading trace", read == true);
+  mu_assert ("error, incorrect trace header", header[0] == TRACE_MAGIC
+             && header[1] == TRACE_VERSION);
+  mu_assert ("error, incorrect trace record", record.type == TRACE_MOVE
+             && record.side == COPS && record.writer == TRACE_WRITER_COPS
+             && record.count == 3 && record.turn == 3
+             && record.latency == 1500);
+  mu_assert ("error, incorrect trace positions", words[0] == 4
+             && words[1] == 2 && words[2] == 7);
+  mu_assert ("error, incorrect appended trace record", reopened == true
+             && appended.writer == TRACE_WRITER_ROBBERS
+             && appended.side == ROBBERS && appended.count == 1
+             && word == 4);
+  return NULL;
+}
+
+/*
+ * Smallest total cost over every injection of rows into columns
+ */
+static int64_t brute_force_assignment (const int64_t *cost, size_t rows,
+                                       size_t cols, size_t row, bool *used)
+{
+  if (row == rows)
+    return 0;
+  int64_t best = INT64_MAX;
+  for (size_t j = 0; j < cols; j++)
+    if (!used[j])
+      {
+        used[j] = true;
+        int64_t total = cost[row * cols + j]
+          + brute_force_assignment (cost, rows, cols, row + 1, used);
+        best = total < best ? total : best;
+        used[j] = false;
+      }
+  return best;
+}
+
+static char *test_assignment_brute_force ()
+{
+  int64_t cost[5 * 6];
+  size_t column[5];
+  bool used[6] = { false };
+  bool optimal = true, valid = true;
+  srand (42);
+  for (size_t trial = 0; trial < 50; trial++)
+    {
+      size_t rows = 1 + trial % 5, cols = rows + trial % 2;
+      for (size_t k = 0; k < rows * cols; k++)
+        cost[k] = rand () % 20;
+      assignment a;
+      assignment_create (&a);
+      int64_t total = assignment_solve (&a, cost, rows, cols, column);
+      assignment_destroy (&a);
+      optimal = optimal
+        && total == brute_force_assignment (cost, rows, cols, 0, used);
+      for (size_t i = 0; i < rows; i++)
+        for (size_t k = 0; k < i; k++)
+          valid = valid && column[i] < cols && column[i] != column[k];
+    }
+
+  mu_assert ("error, assignment should be optimal", optimal);
+  mu_assert ("error, assigned columns should be distinct", valid);
+  return NULL;
+}
+
+static char *test_assignment_warm_start ()
+{
+  size_t n = 40;
+  int64_t *cost = calloc (n * n, sizeof (*cost));
+  size_t *column = calloc (n, sizeof (*column));
+  srand (7);
+  for (size_t k = 0; k < n * n; k++)
+    cost[k] = rand () % 100;
+  assignment warm, cold;
+  assignment_create (&warm);
+  assignment_create (&cold);
+  assignment_solve (&warm, cost, n, n, column);
+  size_t first = warm.augmentations;
+  // Move a few pieces by one step
+  for (size_t k = 0; k < n * n; k += 37)
+    cost[k] += 1;
+  int64_t warm_total = assignment_solve (&warm, cost, n, n, column);
+  int64_t cold_total = assignment_solve (&cold, cost, n, n, NULL);
+  bool rectangular = assignment_solve (&warm, cost, n, n - 1, NULL) == -1;
+
+  mu_assert ("error, warm start should give the optimal cost",
+             warm_total == cold_total);
+  mu_assert ("error, warm start should need fewer augmentations",
+             first == n && warm.augmentations < n / 2);
+  mu_assert ("error, more rows than columns should be rejected",
+             rectangular);
+
+  assignment_destroy (&warm);
+  assignment_destroy (&cold);
+  free (cost);
+  free (column);
+  return NULL;
+}
+
+static char *test_pieces_capture ()
+{
+  pieces cops, robbers;
+  pieces_create (&cops, 2);
+  pieces_create (&robbers, 4);
+  size_t cop_vertices[] = { 3, 5 };
+  size_t robber_vertices[] = { 5, 1, 3, 2 };
+  pieces_set (&cops, cop_vertices);
+  pieces_set (&robbers, robber_vertices);
+  uint8_t occupied[8] = { 0 };
+  uint32_t captured[4];
+  size_t count = pieces_capture (&robbers, &cops, occupied, captured);
+  size_t alive[4];
+  size_t alive_size = pieces_alive_vertices (&robbers, alive);
+  // Moves of the alive robbers only, in id order
+  size_t moves[] = { 0, 1 };
+  pieces_set (&robbers, moves);
+  bool cleared = true;
+  for (size_t v = 0; v < 8; v++)
+    cleared = cleared && occupied[v] == 0;
+
+  mu_assert ("error, robbers on cops should be captured", count == 2
+             && captured[0] == 0 && captured[1] == 2);
+  mu_assert ("error, alive robbers should keep their order",
+             alive_size == 2 && robbers.alive_size == 2 && alive[0] == 1
+             && alive[1] == 2);
+  mu_assert ("error, moves should only apply to alive robbers",
+             robbers.vertices[1] == 0 && robbers.vertices[3] == 1
+             && robbers.vertices[0] == 5 && !robbers.alive[0]);
+  mu_assert ("error, occupied marks should be cleared", cleared);
+
+  pieces_destroy (&cops);
+  pieces_destroy (&robbers);
+  return NULL;
+}
+
+static char *test_pieces_valid_moves ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 2\nRobbers: 1\nMax turn: 10\n"
+    "Vertices: 4\n0 0\n0 0\n0 0\n0 0\n" "Edges: 3\n0 1\n1 2\n2 3\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  pieces cops;
+  pieces_create (&cops, 2);
+  size_t initial[] = { 0, 3 };
+  size_t far[] = { 2, 3 };
+  size_t out[] = { 0, 4 };
+  size_t valid[] = { 1, 2 };
+  bool unplaced = pieces_valid_moves (&cops, &b, far);
+  bool outside = pieces_valid_moves (&cops, &b, out);
+  pieces_set (&cops, initial);
+
+  mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, any vertex should be valid before placement",
+             unplaced && !outside);
+  mu_assert ("error, moves to non neighbors should be invalid",
+             !pieces_valid_moves (&cops, &b, far));
+  mu_assert ("error, moves to neighbors should be valid",
+             pieces_valid_moves (&cops, &b, valid));
+
+  pieces_destroy (&cops);
+  board_destroy (&b);
+  return NULL;
+}
+
+static char *test_trace_write_large ()
+{
+  remove ("algo_tests.trace");
+  size_t count = TRACE_BUFFER_SIZE;
+  uint32_t *positions = calloc (count, sizeof (*positions));
+  for (size_t i = 0; i < count; i++)
+    positions[i] = i;
+  trace *t = calloc (1, sizeof (*t));
+  bool opened = trace_open (t, "algo_tests.trace", TRACE_WRITER_COPS);
+  uint32_t vertex = 3;
+  trace_write (t, TRACE_CAPTURE, ROBBERS, 2, 0, &vertex, 1);
+  trace_write (t, TRACE_MOVE, COPS, 3, 0, positions, count);
+  trace_close (t);
+  free (t);
+
+  FILE *file = fopen ("algo_tests.trace", "rb");
+  uint32_t header[2], word;
+  trace_record first, second;
+  uint32_t *words = calloc (count, sizeof (*words));
+  bool read = file != NULL && fread (header, sizeof (header), 1, file) == 1
+    && fread (&first, sizeof (first), 1, file) == 1
+    && fread (&word, sizeof (word), 1, file) == 1
+    && fread (&second, sizeof (second), 1, file) == 1
+    && fread (words, sizeof (*words), count, file) == count;
+  if (file != NULL)
+    fclose (file);
+  remove ("algo_tests.trace");
+  bool same = read && memcmp (words, positions, count * sizeof (*words)) == 0;
+  free (positions);
+  free (words);
+
+  mu_assert ("error, failure opening trace", opened == true);
+  mu_assert ("error, records should be kept in order", read
+             && first.type == TRACE_CAPTURE && word == 3);
+  mu_assert ("error, records bigger than the buffer should be written",
+             second.type == TRACE_MOVE && second.count == count && same);
+  return NULL;
+}
+
 char *(*tests_functions[]) () = {
   test_board_read_from_null_file,
   test_board_read_from_null_board,
@@ -290,6 +1009,25 @@ char *(*tests_functions[]) () = {
   test_board_Floyd_Warshall_chain,
   test_board_Floyd_Warshall_single,
   test_board_Floyd_Warshall_square,
+  test_board_label_components_disconnected,
+  test_board_Floyd_Warshall_disconnected,
+  test_board_Floyd_Warshall_weighted,
+  test_board_read_from_invalid_weight,
+  test_board_Floyd_Warshall_blocked_unit_weights,
+  test_board_reorder,
+  test_vertex_set_operations,
+  test_board_expand,
+  test_tablebase_solve_chain,
+  test_tablebase_solve_disconnected,
+  test_tablebase_write_load,
+  test_trace_write,
+  test_trace_write_large,
+  test_mcts_policy_chase,
+  test_mcts_search_capture,
+  test_assignment_brute_force,
+  test_assignment_warm_start,
+  test_pieces_capture,
+  test_pieces_valid_moves,
 };
 
 int main (int argc, const char *argv[])
@@ -0,0 +1,194 @@
+#include "assignment.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ASSIGNMENT_INFINITY INT64_MAX
+
+void assignment_create (assignment * self)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  self->rows = 0;
+  self->cols = 0;
+  self->u = NULL;
+  self->v = NULL;
+  self->row_of = NULL;
+  self->augmentations = 0;
+}
+
+void assignment_destroy (assignment * self)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  free (self->u);
+  free (self->v);
+  free (self->row_of);
+  assignment_create (self);
+}
+
+void assignment_reset (assignment * self)
+{
+  if (self == NULL || self->u == NULL)
+    {
+      return;
+    }
+  memset (self->u, 0, (self->cols + 1) * sizeof (*self->u));
+  memset (self->v, 0, (self->cols + 1) * sizeof (*self->v));
+  memset (self->row_of, 0, (self->cols + 1) * sizeof (*self->row_of));
+}
+
+/*
+ * Cost of row i and column j, rows past the real ones are free so that
+ * the problem is square
+ */
+static inline int64_t assignment_cost (const int64_t *cost, size_t rows,
+                                       size_t cols, size_t i, size_t j)
+{
+  return i <= rows ? cost[(i - 1) * cols + (j - 1)] : 0;
+}
+
+/*
+ * Make the kept solution consistent with the new costs: column
+ * potentials are kept, row potentials become the largest feasible ones
+ * and matched edges that are no longer tight are dropped
+ */
+static void assignment_warm_start (assignment * self, const int64_t *cost)
+{
+  size_t rows = self->rows, n = self->cols;
+  size_t *col_of = calloc (n + 1, sizeof (*col_of));
+  for (size_t j = 1; j <= n; j++)
+    col_of[self->row_of[j]] = j;
+  for (size_t i = 1; i <= n; i++)
+    {
+      int64_t best = ASSIGNMENT_INFINITY;
+      for (size_t j = 1; j <= n; j++)
+        {
+          int64_t reduced = assignment_cost (cost, rows, n, i, j)
+            - self->v[j];
+          best = reduced < best ? reduced : best;
+        }
+      self->u[i] = best;
+      size_t j = col_of[i];
+      if (j != 0
+          && assignment_cost (cost, rows, n, i, j) - self->v[j] != best)
+        self->row_of[j] = 0;
+    }
+  free (col_of);
+}
+
+/*
+ * Add row i0 to the matching along a shortest augmenting path of
+ * reduced costs, updating potentials as in Dijkstra's algorithm
+ */
+static void assignment_augment (assignment * self, const int64_t *cost,
+                                size_t i0, int64_t * min_reduced,
+                                size_t *way, bool *used)
+{
+  size_t rows = self->rows, cols = self->cols;
+  size_t *row_of = self->row_of;
+  for (size_t j = 0; j <= cols; j++)
+    {
+      min_reduced[j] = ASSIGNMENT_INFINITY;
+      used[j] = false;
+    }
+  row_of[0] = i0;
+  size_t j0 = 0;
+  do
+    {
+      used[j0] = true;
+      size_t i1 = row_of[j0], j1 = 0;
+      int64_t delta = ASSIGNMENT_INFINITY;
+      for (size_t j = 1; j <= cols; j++)
+        {
+          if (used[j])
+            continue;
+          int64_t reduced = assignment_cost (cost, rows, cols, i1, j)
+            - self->u[i1] - self->v[j];
+          if (reduced < min_reduced[j])
+            {
+              min_reduced[j] = reduced;
+              way[j] = j0;
+            }
+          if (min_reduced[j] < delta)
+            {
+              delta = min_reduced[j];
+              j1 = j;
+            }
+        }
+      for (size_t j = 0; j <= cols; j++)
+        {
+          if (used[j])
+            {
+              self->u[row_of[j]] += delta;
+              self->v[j] -= delta;
+            }
+          else
+            min_reduced[j] -= delta;
+        }
+      j0 = j1;
+    }
+  while (row_of[j0] != 0);
+  do
+    {
+      size_t j1 = way[j0];
+      row_of[j0] = row_of[j1];
+      j0 = j1;
+    }
+  while (j0 != 0);
+  self->augmentations++;
+}
+
+int64_t assignment_solve (assignment * self, const int64_t *cost,
+                          size_t rows, size_t cols, size_t *column)
+{
+  if (self == NULL || cost == NULL || rows > cols)
+    {
+      return -1;
+    }
+  if (self->u == NULL || rows != self->rows || cols != self->cols)
+    {
+      assignment_destroy (self);
+      self->rows = rows;
+      self->cols = cols;
+      self->u = calloc (cols + 1, sizeof (*self->u));
+      self->v = calloc (cols + 1, sizeof (*self->v));
+      self->row_of = calloc (cols + 1, sizeof (*self->row_of));
+    }
+  self->augmentations = 0;
+  self->row_of[0] = 0;
+  self->v[0] = 0;
+  assignment_warm_start (self, cost);
+
+  int64_t *min_reduced = calloc (cols + 1, sizeof (*min_reduced));
+  size_t *way = calloc (cols + 1, sizeof (*way));
+  bool *used = calloc (cols + 1, sizeof (*used));
+  bool *matched = calloc (cols + 1, sizeof (*matched));
+  for (size_t j = 1; j <= cols; j++)
+    matched[self->row_of[j]] = true;
+  for (size_t i = 1; i <= cols; i++)
+    if (!matched[i])
+      assignment_augment (self, cost, i, min_reduced, way, used);
+  self->row_of[0] = 0;
+
+  int64_t total = 0;
+  for (size_t j = 1; j <= cols; j++)
+    {
+      size_t i = self->row_of[j];
+      if (i != 0 && i <= rows)
+        {
+          total += assignment_cost (cost, rows, cols, i, j);
+          if (column != NULL)
+            column[i - 1] = j - 1;
+        }
+    }
+  free (min_reduced);
+  free (way);
+  free (used);
+  free (matched);
+  return total;
+}
@@ -0,0 +1,50 @@
+#ifndef ASSIGNMENT_H
+#define ASSIGNMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Minimum cost assignment of rows to distinct columns (rows <= cols)
+ * with the Hungarian algorithm, free rows being added to make the
+ * problem square. Potentials and matching are kept between calls so
+ * that solving costs close to the previous ones only needs a few
+ * augmentations. Arrays are indexed from 1, 0 meaning no row or
+ * column.
+ */
+typedef struct
+{
+  size_t rows;
+  size_t cols;
+  int64_t *u;
+  int64_t *v;
+  size_t *row_of;
+  size_t augmentations;
+} assignment;
+
+/*
+ * Create an empty assignment by initializing each member
+ */
+void assignment_create (assignment * self);
+
+/*
+ * Destroy an assignment by freeing its arrays
+ */
+void assignment_destroy (assignment * self);
+
+/*
+ * Forget the previous solution so that the next solve starts cold
+ */
+void assignment_reset (assignment * self);
+
+/*
+ * Assign each row to a column minimizing the total cost, cost being a
+ * rows * cols row-major matrix, write the column of each row in
+ * column and return the total cost (-1 if rows > cols). The previous
+ * solution is reused if the dimensions did not change.
+ */
+int64_t assignment_solve (assignment * self, const int64_t *cost,
+                          size_t rows, size_t cols, size_t *column);
+
+#endif // ASSIGNMENT_H
@@ -0,0 +1,354 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "algo.h"
+#include "assignment.h"
+#include "pieces.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Side of the grid pieces walk on, distances being Manhattan ones
+ */
+#define BENCH_GRID 64
+
+#define BENCH_TURNS 50
+
+/*
+ * Board of BENCH_RINGS disjoint cycles of BENCH_RING vertices
+ */
+#define BENCH_RINGS 512
+#define BENCH_RING 16
+
+/*
+ * Steps of the random walks of the ordering benchmark, each one
+ * reading the distance from every neighbor to BENCH_TARGETS vertices
+ */
+#define BENCH_STEPS 2000000
+#define BENCH_TARGETS 8
+
+static double bench_now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*
+ * Move a piece one step in a random direction inside the grid
+ */
+static void bench_step (int *x, int *y)
+{
+  int direction = rand () % 5;
+  int dx = direction == 0 ? 1 : direction == 1 ? -1 : 0;
+  int dy = direction == 2 ? 1 : direction == 3 ? -1 : 0;
+  if (*x + dx >= 0 && *x + dx < BENCH_GRID)
+    *x += dx;
+  if (*y + dy >= 0 && *y + dy < BENCH_GRID)
+    *y += dy;
+}
+
+static void bench_costs (int64_t * cost, size_t n, const int *x,
+                         const int *y)
+{
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      cost[i * n + j] = abs (x[i] - x[n + j]) + abs (y[i] - y[n + j]);
+}
+
+/*
+ * Play turns where n cops and n robbers all take one random step and
+ * compare solving each turn from scratch and from the previous one
+ */
+static void bench_assignment (size_t n)
+{
+  int *x = calloc (2 * n, sizeof (*x));
+  int *y = calloc (2 * n, sizeof (*y));
+  int64_t *cost = calloc (n * n, sizeof (*cost));
+  size_t *column = calloc (n, sizeof (*column));
+  for (size_t k = 0; k < 2 * n; k++)
+    {
+      x[k] = rand () % BENCH_GRID;
+      y[k] = rand () % BENCH_GRID;
+    }
+  assignment warm, cold;
+  assignment_create (&warm);
+  assignment_create (&cold);
+  bench_costs (cost, n, x, y);
+  assignment_solve (&warm, cost, n, n, column);
+
+  double cold_time = 0, warm_time = 0;
+  size_t cold_augmentations = 0, warm_augmentations = 0;
+  bool agree = true;
+  for (size_t turn = 0; turn < BENCH_TURNS; turn++)
+    {
+      for (size_t k = 0; k < 2 * n; k++)
+        bench_step (&x[k], &y[k]);
+      bench_costs (cost, n, x, y);
+      double start = bench_now ();
+      assignment_reset (&cold);
+      int64_t cold_total = assignment_solve (&cold, cost, n, n, column);
+      double middle = bench_now ();
+      int64_t warm_total = assignment_solve (&warm, cost, n, n, column);
+      double end = bench_now ();
+      cold_time += middle - start;
+      warm_time += end - middle;
+      cold_augmentations += cold.augmentations;
+      warm_augmentations += warm.augmentations;
+      agree = agree && cold_total == warm_total;
+    }
+  printf ("%4zu pieces: cold %8.3f ms/turn %6.1f augmentations, "
+          "warm %8.3f ms/turn %6.1f augmentations%s\n", n,
+          1e3 * cold_time / BENCH_TURNS,
+          (double) cold_augmentations / BENCH_TURNS,
+          1e3 * warm_time / BENCH_TURNS,
+          (double) warm_augmentations / BENCH_TURNS,
+          agree ? "" : " (costs differ)");
+  assignment_destroy (&warm);
+  assignment_destroy (&cold);
+  free (x);
+  free (y);
+  free (cost);
+  free (column);
+}
+
+/*
+ * Read the board of disjoint cycles
+ */
+static bool bench_board (board * b)
+{
+  size_t n = BENCH_RINGS * BENCH_RING;
+  FILE *file = tmpfile ();
+  fprintf (file, "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: %zu\n", n);
+  for (size_t v = 0; v < n; v++)
+    fprintf (file, "0 0\n");
+  fprintf (file, "Edges: %zu\n", n);
+  for (size_t v = 0; v < n; v++)
+    fprintf (file, "%zu %zu\n", v, v - v % BENCH_RING
+             + (v + 1) % BENCH_RING);
+  rewind (file);
+  board_create (b);
+  bool read = board_read_from (b, file);
+  fclose (file);
+  return read;
+}
+
+/*
+ * Random walk of n cops and n robbers: each turn validates and plays
+ * the moves of both sides, captures robbers and lists the alive ones,
+ * as game does. Captured robbers are put back so that the count stays
+ * n. The capture is also timed with the pairwise scan it replaced.
+ */
+static void bench_pieces (board * b, size_t n)
+{
+  pieces cops, robbers;
+  pieces_create (&cops, n);
+  pieces_create (&robbers, n);
+  uint8_t *occupied = calloc (b->size, sizeof (*occupied));
+  uint32_t *captured = calloc (n, sizeof (*captured));
+  size_t *move = calloc (n, sizeof (*move));
+  for (size_t i = 0; i < n; i++)
+    move[i] = rand () % b->size;
+  pieces_set (&cops, move);
+  for (size_t i = 0; i < n; i++)
+    move[i] = rand () % b->size;
+  pieces_set (&robbers, move);
+
+  double turn_time = 0, pairwise_time = 0;
+  size_t captures = 0, pairwise_captures = 0;
+  bool valid = true;
+  for (size_t turn = 0; turn < BENCH_TURNS; turn++)
+    {
+      double start = bench_now ();
+      pieces *sides[] = { &cops, &robbers };
+      for (size_t s = 0; s < 2; s++)
+        {
+          size_t k = pieces_alive_vertices (sides[s], move);
+          for (size_t i = 0; i < k; i++)
+            {
+              board_vertex *v = b->vertices[move[i]];
+              size_t digit = rand () % (v->degree + 1);
+              move[i] = digit < v->degree ? v->neighbors[digit]->index
+                : move[i];
+            }
+          valid = valid && pieces_valid_moves (sides[s], b, move);
+          pieces_set (sides[s], move);
+        }
+      size_t middle_captures = 0;
+      double pairwise_start = bench_now ();
+      for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < n; j++)
+          if (robbers.alive[i] && robbers.vertices[i] == cops.vertices[j])
+            {
+              middle_captures++;
+              break;
+            }
+      double pairwise_end = bench_now ();
+      size_t count = pieces_capture (&robbers, &cops, occupied, captured);
+      pieces_alive_vertices (&robbers, move);
+      for (size_t i = 0; i < count; i++)
+        {
+          robbers.alive[captured[i]] = true;
+          robbers.alive_size++;
+        }
+      double end = bench_now ();
+      turn_time += end - pairwise_end + pairwise_start - start;
+      pairwise_time += pairwise_end - pairwise_start;
+      captures += count;
+      pairwise_captures += middle_captures;
+    }
+  printf ("%6zu pieces: %8.3f ms/turn %6.1f ns/piece, pairwise capture "
+          "%9.3f ms/turn, %zu captures%s\n", 2 * n,
+          1e3 * turn_time / BENCH_TURNS, 1e9 * turn_time / BENCH_TURNS
+          / (2 * n), 1e3 * pairwise_time / BENCH_TURNS, captures,
+          valid && captures == pairwise_captures ? "" : " (mismatch)");
+  pieces_destroy (&cops);
+  pieces_destroy (&robbers);
+  free (occupied);
+  free (captured);
+  free (move);
+}
+
+/*
+ * Write the board of b with vertex v renamed permutation[v]
+ */
+static FILE *bench_permuted (board * b, const size_t *permutation)
+{
+  FILE *file = tmpfile ();
+  fprintf (file, "Cops: %zu\nRobbers: %zu\nMax turn: %zu\nVertices: %zu\n",
+           b->cops, b->robbers, b->max_turn, b->size);
+  size_t edges = 0;
+  for (size_t v = 0; v < b->size; v++)
+    {
+      fprintf (file, "0 0\n");
+      edges += b->vertices[v]->degree;
+    }
+  fprintf (file, "Edges: %zu\n", edges / 2);
+  for (size_t u = 0; u < b->size; u++)
+    for (size_t i = 0; i < b->vertices[u]->degree; i++)
+      {
+        size_t v = b->vertices[u]->neighbors[i]->index;
+        if (u > v)
+          continue;
+        if (b->weighted)
+          fprintf (file, "%zu %zu %u\n", permutation[u], permutation[v],
+                   b->vertices[u]->weights[i]);
+        else
+          fprintf (file, "%zu %zu\n", permutation[u], permutation[v]);
+      }
+  rewind (file);
+  return file;
+}
+
+/*
+ * Random walks reading distances from the neighbors of the current
+ * vertex as rollout policies do, returning a checksum
+ */
+static size_t bench_walk (board * b)
+{
+  size_t targets[BENCH_TARGETS];
+  for (size_t t = 0; t < BENCH_TARGETS; t++)
+    targets[t] = rand () % b->size;
+  size_t vertex = rand () % b->size, sum = 0;
+  for (size_t step = 0; step < BENCH_STEPS; step++)
+    {
+      board_vertex *v = b->vertices[vertex];
+      for (size_t i = 0; i < v->degree; i++)
+        for (size_t t = 0; t < BENCH_TARGETS; t++)
+          sum += board_dist (b, v->neighbors[i]->index, targets[t]);
+      vertex = v->degree == 0 ? vertex
+        : v->neighbors[rand () % v->degree]->index;
+      if (step % 64 == 0)
+        targets[rand () % BENCH_TARGETS] = rand () % b->size;
+    }
+  return sum;
+}
+
+/*
+ * Load filename in file order and with shuffled indices, with every
+ * vertex order, and time loading and walking
+ */
+static void bench_order (const char *filename)
+{
+  FILE *original = fopen (filename, "r");
+  board b;
+  board_create (&b);
+  if (original == NULL || !board_read_from (&b, original))
+    {
+      fprintf (stderr, "Error reading board %s\n", filename);
+      if (original != NULL)
+        fclose (original);
+      board_destroy (&b);
+      return;
+    }
+  fclose (original);
+  size_t *identity = calloc (b.size, sizeof (*identity));
+  size_t *shuffled = calloc (b.size, sizeof (*shuffled));
+  for (size_t v = 0; v < b.size; v++)
+    identity[v] = shuffled[v] = v;
+  for (size_t v = b.size; v > 1; v--)
+    {
+      size_t k = rand () % v, t = shuffled[v - 1];
+      shuffled[v - 1] = shuffled[k];
+      shuffled[k] = t;
+    }
+
+  const char *names[] = { "file", "bfs", "rcm" };
+  printf ("%s, %zu vertices\n", filename, b.size);
+  for (size_t s = 0; s < 2; s++)
+    for (size_t order = BOARD_ORDER_FILE; order <= BOARD_ORDER_RCM; order++)
+      {
+        FILE *file = bench_permuted (&b, s == 0 ? identity : shuffled);
+        board ordered;
+        board_create (&ordered);
+        ordered.order = order;
+        double start = bench_now ();
+        board_read_from (&ordered, file);
+        double middle = bench_now ();
+        srand (2);
+        size_t sum = bench_walk (&ordered);
+        double end = bench_now ();
+        fclose (file);
+        printf ("  %s ids, %s order: load %8.3f ms, walk %8.3f ms "
+                "(checksum %zu)\n", s == 0 ? "file" : "shuffled",
+                names[order], 1e3 * (middle - start), 1e3 * (end - middle),
+                sum);
+        board_destroy (&ordered);
+      }
+  free (identity);
+  free (shuffled);
+  board_destroy (&b);
+}
+
+int main (int argc, const char *argv[])
+{
+  if (argc > 1)
+    {
+      // Only compare vertex orders of the given boards
+      srand (1);
+      for (int i = 1; i < argc; i++)
+        bench_order (argv[i]);
+      return 0;
+    }
+
+  size_t sizes[] = { 8, 32, 128, 256, 512 };
+  srand (1);
+  printf ("Assignment, %d turns on a %dx%d grid\n", BENCH_TURNS, BENCH_GRID,
+          BENCH_GRID);
+  for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    bench_assignment (sizes[i]);
+
+  board b;
+  if (!bench_board (&b))
+    {
+      fprintf (stderr, "Error building the benchmark board\n");
+      return 1;
+    }
+  size_t counts[] = { 500, 1000, 2000, 4000, 8000 };
+  printf ("Pieces, %d turns on %d cycles of %d vertices\n", BENCH_TURNS,
+          BENCH_RINGS, BENCH_RING);
+  for (size_t i = 0; i < sizeof (counts) / sizeof (counts[0]); i++)
+    bench_pieces (&b, counts[i]);
+  board_destroy (&b);
+}
@@ -1,130 +1,558 @@
+#define _XOPEN_SOURCE 700
+
 #include "algo.h"
+#include "assignment.h"
+#include "mcts.h"
+#include "pieces.h"
+#include "tablebase.h"
+#include "trace.h"
 
 #include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
 
+/*
+ * Board and tablebase loaded once and only read by games
+ */
 typedef struct
 {
-  board_vertex **positions;
-  size_t size;
-} vector;
+  char *filename;
+  board b;
+  tablebase tb;
+} game_board;
 
-void vector_create (vector * self)
+typedef struct
+{
+  board *b;
+  pieces cops;
+  pieces robbers;
+  uint8_t *occupied;
+  size_t remaining_turn;
+  enum role r;
+  tablebase *tb;
+  trace *t;
+  double move_time;
+  size_t threads;
+  assignment targets;
+} game;
+
+/*
+ * Largest number of states solved at startup when no tablebase file
+ * exists, bigger boards must be solved beforehand with ./solve. Both
+ * players solve during the first move of server.py, about 0.2 s each
+ * on one core at this size, which stays well under the timeout.
+ */
+#define GAME_SOLVE_STATES ((size_t) 1 << 18)
+
+/*
+ * Default largest number of matches played at the same time by the
+ * daemon, workers being started on demand up to it
+ */
+#define GAME_WORKERS 256
+
+/*
+ * Default time spent searching each move without tablebase, in
+ * milliseconds, overridden by the GAME_MOVE_TIME environment variable
+ */
+#define GAME_MOVE_TIME 500
+
+/*
+ * Create a game of role r on a loaded board
+ */
+void game_create (game * self, game_board * shared, enum role r)
 {
   if (self == NULL)
     return;
-  self->positions = NULL;
-  self->size = 0;
+  self->b = &(shared->b);
+  self->tb = &(shared->tb);
+  pieces_create (&(self->cops), self->b->cops);
+  pieces_create (&(self->robbers), self->b->robbers);
+  self->occupied = calloc (self->b->size + 1, sizeof (*self->occupied));
+  self->remaining_turn = self->b->max_turn + 2;
+  self->r = r;
+  self->t = NULL;
+  self->threads = 0;
+  assignment_create (&(self->targets));
+  const char *move_time = getenv ("GAME_MOVE_TIME");
+  self->move_time = (move_time != NULL ? atoi (move_time) : GAME_MOVE_TIME)
+    / 1000.0;
 }
 
-void vector_destroy (vector * self)
+/*
+ * Destroy a game, the board it was created on is left untouched
+ */
+void game_destroy (game * self)
 {
   if (self == NULL)
     return;
-  free (self->positions);
+  pieces_destroy (&(self->cops));
+  pieces_destroy (&(self->robbers));
+  free (self->occupied);
+  trace_close (self->t);
+  free (self->t);
+  assignment_destroy (&(self->targets));
 }
 
-void vector_remove_at (vector * self, size_t index)
+/*
+ * Return the number of the move being played, 0 and 1 being the
+ * initial positions
+ */
+uint32_t game_turn (game * self)
 {
-  if (self == NULL || index >= self->size || self->size == 0)
-    return;
-  for (size_t i = index; i < self->size - 1; i++)
-    self->positions[i] = self->positions[i + 1];
-  self->size--;
+  return self->b->max_turn + 2 - self->remaining_turn;
 }
 
-void vector_print (vector * self)
+/*
+ * Append a trace of the game to filename
+ */
+void game_open_trace (game * self, const char *filename)
 {
-  if (self == NULL)
-    return;
-  for (size_t i = 0; i < self->size; i++)
-    printf ("%zu\n", self->positions[i]->index);
-  fflush (stdout);
+  self->t = calloc (1, sizeof (*self->t));
+  enum trace_writer writer = self->r == COPS ? TRACE_WRITER_COPS :
+    TRACE_WRITER_ROBBERS;
+  if (!trace_open (self->t, filename, writer))
+    {
+      fprintf (stderr, "Error opening trace file %s\n", filename);
+      free (self->t);
+      self->t = NULL;
+      return;
+    }
+  uint64_t hash = board_hash (self->b);
+  uint32_t words[] = { hash, hash >> 32, self->b->size, self->b->cops,
+    self->b->robbers, self->b->max_turn
+  };
+  trace_write (self->t, TRACE_MATCH, self->r, 0, 0, words, 6);
 }
 
-typedef struct
+/*
+ * Record new positions of side and the time taken to get them
+ */
+void game_trace_move (game * self, enum role side, uint32_t latency)
 {
-  board b;
-  vector cops;
-  vector robbers;
-  size_t remaining_turn;
-  enum role r;
-} game;
+  if (self->t == NULL)
+    return;
+  pieces *p = side == COPS ? &(self->cops) : &(self->robbers);
+  uint32_t *words = calloc (p->size + 1, sizeof (*words));
+  size_t count = 0;
+  for (size_t i = 0; i < p->size; i++)
+    if (p->alive[i])
+      words[count++] = p->vertices[i];
+  trace_write (self->t, TRACE_MOVE, side, game_turn (self), latency, words,
+               count);
+  free (words);
+}
 
-void game_create (game * self)
+/*
+ * Map the tablebase stored next to the board file, or solve the board
+ * and store it if it is small enough
+ */
+void game_board_load_tablebase (game_board * self, size_t threads)
 {
-  if (self == NULL)
+  char path[4096];
+  snprintf (path, sizeof (path), "%s.tb", self->filename);
+  if (tablebase_load (&(self->tb), &(self->b), path))
+    {
+      fprintf (stderr, "Loaded tablebase %s\n", path);
+      return;
+    }
+  size_t states = tablebase_states (&(self->b));
+  if (states == 0 || states > GAME_SOLVE_STATES)
     return;
+  if (tablebase_solve (&(self->tb), &(self->b), threads))
+    {
+      fprintf (stderr, "Solved %zu states\n", states);
+      if (!tablebase_write (&(self->tb), &(self->b), path))
+        fprintf (stderr, "Could not write tablebase %s\n", path);
+    }
+}
+
+/*
+ * Read the board file, build its neighborhood bitboards and load its
+ * tablebase, return false if the file cannot be opened or parsed, a
+ * tablebase being solved with threads threads (0 for one per online
+ * processor). The BOARD_ORDER environment variable (bfs or rcm)
+ * renumbers vertices in distance tables.
+ */
+bool game_board_load (game_board * self, const char *filename,
+                      size_t threads)
+{
   board_create (&(self->b));
-  vector_create (&(self->cops));
-  vector_create (&(self->robbers));
-  self->remaining_turn = 0;
-  self->r = COPS;
+  const char *order = getenv ("BOARD_ORDER");
+  if (order != NULL && strcmp (order, "bfs") == 0)
+    self->b.order = BOARD_ORDER_BFS;
+  else if (order != NULL && strcmp (order, "rcm") == 0)
+    self->b.order = BOARD_ORDER_RCM;
+  tablebase_create (&(self->tb));
+  self->filename = malloc (strlen (filename) + 1);
+  strcpy (self->filename, filename);
+  FILE *file = fopen (filename, "r");
+  if (file == NULL)
+    {
+      fprintf (stderr, "Error opening input file %s\n", filename);
+      return false;
+    }
+  bool success = board_read_from (&(self->b), file);
+  fclose (file);
+  if (!success)
+    {
+      fprintf (stderr, "Error parsing input file %s\n", filename);
+      return false;
+    }
+  // Built now since games share the board without locking
+  board_neighborhoods (&(self->b));
+  game_board_load_tablebase (self, threads);
+  return true;
 }
 
-void game_destroy (game * self)
+void game_board_destroy (game_board * self)
 {
-  if (self == NULL)
-    return;
   board_destroy (&(self->b));
-  vector_destroy (&(self->cops));
-  vector_destroy (&(self->robbers));
+  tablebase_destroy (&(self->tb));
+  free (self->filename);
 }
 
 /*
- * Update positions of either cops or robbers and exit if the moves
- * are invalid
+ * Place cops on the tuple minimizing the worst distance to capture
+ * over every robber placement
  */
-void game_update_position (game * self, size_t *new)
+void game_tablebase_place_cops (game * self, size_t *move)
 {
-  vector *current = self->r == COPS ? &(self->robbers) : &(self->cops);
-  if (current->positions != NULL)
+  tablebase *tb = self->tb;
+  size_t best = 0;
+  unsigned int best_worst = TABLEBASE_LOST + 1;
+  for (size_t tuple = 0; tuple < tb->states / tb->size; tuple++)
     {
-      // Check if moves are valid
-      for (size_t i = 0; i < current->size; i++)
-        if (!board_is_valid_move (&(self->b), current->positions[i]->index,
-                                  new[i]))
-          {
-            fprintf (stderr, "New position is invalid\n");
-            exit (1);
-          }
+      unsigned int worst = 0;
+      for (size_t r = 0; r < tb->size && worst < best_worst; r++)
+        if (tb->cops_dtc[tuple * tb->size + r] > worst)
+          worst = tb->cops_dtc[tuple * tb->size + r];
+      if (worst < best_worst)
+        {
+          best_worst = worst;
+          best = tuple;
+        }
     }
-  else
-    current->positions = calloc (current->size, sizeof (*current->positions));
-  for (size_t i = 0; i < current->size; i++)
+  for (size_t i = self->cops.alive_size; i > 0; i--)
     {
-      current->positions[i] = self->b.vertices[new[i]];
+      move[i - 1] = best % tb->size;
+      best /= tb->size;
     }
 }
 
 /*
- * Return the initial or next positions of either the cops or the
- * robbers
+ * Place each robber on the vertex maximizing the distance to capture,
+ * preferring vertices not used by previous robbers
  */
-vector *game_next_position (game * self)
+void game_tablebase_place_robbers (game * self, const size_t *cops,
+                                   size_t *move)
 {
-  vector *current = self->r == COPS ? &(self->cops) : &(self->robbers);
-  if (current->positions == NULL)
+  for (size_t i = 0; i < self->robbers.alive_size; i++)
     {
-      current->positions =
-        calloc (current->size, sizeof (*current->positions));
-      // Compute initial positions
-      for (size_t i = 0; i < current->size; i++)
+      size_t best = 0;
+      int best_score = -1;
+      for (size_t r = 0; r < self->b->size; r++)
         {
-          if (self->r == COPS)
-            current->positions[i] = self->b.vertices[i];
+          int score = 2 * tablebase_cops_dtc (self->tb, cops, r);
+          bool used = false;
+          for (size_t j = 0; j < i; j++)
+            used = used || move[j] == r;
+          score += used ? 0 : 1;
+          if (score > best_score)
+            {
+              best_score = score;
+              best = r;
+            }
+        }
+      move[i] = best;
+    }
+}
+
+/*
+ * Move cops with the joint move minimizing the distance to capture of
+ * the closest robber, then the sum over all robbers, and return false
+ * if no move captures any robber
+ */
+bool game_tablebase_move_cops (game * self, const size_t *current,
+                               const size_t *robbers, size_t *best)
+{
+  size_t k = self->cops.alive_size;
+  size_t *choice = calloc (k, sizeof (*choice));
+  size_t *candidate = calloc (k, sizeof (*candidate));
+  for (size_t i = 0; i < k; i++)
+    best[i] = current[i];
+  unsigned int best_min = TABLEBASE_LOST + 1;
+  size_t best_sum = SIZE_MAX;
+  bool done = false;
+  while (!done)
+    {
+      // choice[i] == degree means the cop stays on its vertex
+      for (size_t i = 0; i < k; i++)
+        {
+          board_vertex *v = self->b->vertices[current[i]];
+          candidate[i] = choice[i] < v->degree ?
+            v->neighbors[choice[i]]->index : current[i];
+        }
+      unsigned int min = TABLEBASE_LOST;
+      size_t sum = 0;
+      for (size_t j = 0; j < self->robbers.alive_size; j++)
+        {
+          unsigned int dtc = tablebase_robbers_dtc (self->tb, candidate,
+                                                    robbers[j]);
+          min = dtc < min ? dtc : min;
+          sum += dtc;
+        }
+      if (min < best_min || (min == best_min && sum < best_sum))
+        {
+          best_min = min;
+          best_sum = sum;
+          for (size_t i = 0; i < k; i++)
+            best[i] = candidate[i];
+        }
+      // Next joint move in mixed radix order
+      done = true;
+      for (size_t i = 0; i < k && done; i++)
+        {
+          if (++choice[i] <= self->b->vertices[current[i]]->degree)
+            done = false;
           else
-            current->positions[i] = self->b.vertices[self->b.size - i - 1];
+            choice[i] = 0;
         }
     }
-  else
-    // Compute next positions
-    for (size_t i = 0; i < current->size; i++)
+  free (choice);
+  free (candidate);
+  return best_min < TABLEBASE_LOST;
+}
+
+/*
+ * Move each robber to the neighbor maximizing its distance to capture,
+ * preferring vertices not used by previous robbers
+ */
+void game_tablebase_move_robbers (game * self, const size_t *cops,
+                                  const size_t *robbers, size_t *move)
+{
+  for (size_t i = 0; i < self->robbers.alive_size; i++)
+    {
+      board_vertex *v = self->b->vertices[robbers[i]];
+      size_t best = v->index;
+      int best_score = -1;
+      // j == 0 means the robber stays on its vertex
+      for (size_t j = 0; j <= v->degree; j++)
+        {
+          size_t r = j == 0 ? v->index : v->neighbors[j - 1]->index;
+          int score = 2 * tablebase_cops_dtc (self->tb, cops, r);
+          bool used = false;
+          for (size_t k = 0; k < i; k++)
+            used = used || move[k] == r;
+          score += used ? 0 : 1;
+          if (score > best_score)
+            {
+              best_score = score;
+              best = r;
+            }
+        }
+      move[i] = best;
+    }
+}
+
+/*
+ * Place cops one by one on the vertex minimizing the total distance
+ * from every vertex to its closest cop
+ */
+void game_place_cops (game * self, size_t *move)
+{
+  size_t n = self->b->size;
+  size_t *closest = calloc (n, sizeof (*closest));
+  for (size_t v = 0; v < n; v++)
+    closest[v] = BOARD_UNREACHABLE;
+  for (size_t i = 0; i < self->cops.alive_size; i++)
+    {
+      size_t best = 0, best_total = SIZE_MAX;
+      for (size_t c = 0; c < n; c++)
+        {
+          size_t total = 0;
+          for (size_t v = 0; v < n && total < best_total; v++)
+            {
+              size_t d = board_dist (self->b, c, v);
+              total += d < closest[v] ? d : closest[v];
+            }
+          if (total < best_total)
+            {
+              best_total = total;
+              best = c;
+            }
+        }
+      for (size_t v = 0; v < n; v++)
+        {
+          size_t d = board_dist (self->b, best, v);
+          closest[v] = d < closest[v] ? d : closest[v];
+        }
+      move[i] = best;
+    }
+  free (closest);
+}
+
+/*
+ * Place each robber on the vertex farthest from every cop, preferring
+ * vertices not used by previous robbers
+ */
+void game_place_robbers (game * self, const size_t *cops, size_t *move)
+{
+  // Closest cop of every vertex, one sweep per cop
+  size_t n = self->b->size;
+  size_t *closest = calloc (n + 1, sizeof (*closest));
+  for (size_t r = 0; r < n; r++)
+    closest[r] = BOARD_UNREACHABLE;
+  for (size_t j = 0; j < self->cops.alive_size; j++)
+    for (size_t r = 0; r < n; r++)
+      {
+        size_t d = board_dist (self->b, r, cops[j]);
+        closest[r] = d < closest[r] ? d : closest[r];
+      }
+  for (size_t i = 0; i < self->robbers.alive_size; i++)
+    {
+      size_t best = 0, best_score = 0;
+      for (size_t r = 0; r < n; r++)
+        {
+          bool used = self->occupied[r] != 0;
+          size_t score = 2 * closest[r] + (used ? 0 : 1);
+          if (score > best_score)
+            {
+              best_score = score;
+              best = r;
+            }
+        }
+      move[i] = best;
+      self->occupied[best] = 1;
+    }
+  for (size_t i = 0; i < self->robbers.alive_size; i++)
+    self->occupied[move[i]] = 0;
+  free (closest);
+}
+
+/*
+ * Assign cops to distinct robbers minimizing the total distance, the
+ * side with fewer pieces being the rows, and write in targets the
+ * robber chased by each cop (SIZE_MAX for cops left without one). The
+ * assignment of the previous turn is the starting point.
+ */
+void game_assign_targets (game * self, const size_t *cops,
+                          const size_t *robbers, size_t *targets)
+{
+  size_t c = self->cops.alive_size, r = self->robbers.alive_size;
+  bool by_cop = c <= r;
+  size_t rows = by_cop ? c : r, cols = by_cop ? r : c;
+  int64_t *cost = calloc (rows * cols + 1, sizeof (*cost));
+  size_t *column = calloc (rows + 1, sizeof (*column));
+  for (size_t i = 0; i < c; i++)
+    for (size_t j = 0; j < r; j++)
       {
-        current->positions[i] = current->positions[i];
+        // Unreachable robbers cost more than any finite distance
+        size_t d = board_dist (self->b, cops[i], robbers[j]);
+        cost[by_cop ? i * cols + j : j * cols + i] = (int64_t) d;
       }
+  assignment_solve (&(self->targets), cost, rows, cols, column);
+  for (size_t i = 0; i < c; i++)
+    targets[i] = SIZE_MAX;
+  for (size_t i = 0; i < rows; i++)
+    {
+      if (by_cop)
+        targets[i] = column[i];
+      else
+        targets[column[i]] = i;
+    }
+  free (cost);
+  free (column);
+}
+
+/*
+ * Search the next positions of our side with Monte Carlo tree search
+ */
+void game_mcts_move (game * self, const size_t *cops, const size_t *robbers,
+                     size_t *move)
+{
+  size_t *targets = NULL;
+  if (self->r == COPS && self->robbers.alive_size > 0)
+    {
+      targets = calloc (self->cops.alive_size + 1, sizeof (*targets));
+      game_assign_targets (self, cops, robbers, targets);
+    }
+  mcts_position position = { self->b, self->cops.alive_size, cops,
+    self->robbers.alive_size, robbers, self->r, self->remaining_turn,
+    targets
+  };
+  mcts_stats stats;
+  mcts_search (&position, self->move_time, self->threads, move, &stats);
+  fprintf (stderr, "MCTS: %zu playouts in %.3f s on %zu threads "
+           "(%.0f playouts/s)\n", stats.playouts, stats.seconds,
+           stats.threads, stats.seconds > 0 ? stats.playouts / stats.seconds
+           : 0.0);
+  free (targets);
+}
+
+/*
+ * Update positions of either cops or robbers and return false if the
+ * moves are invalid
+ */
+bool game_update_position (game * self, size_t *new)
+{
+  pieces *current = self->r == COPS ? &(self->robbers) : &(self->cops);
+  if (!pieces_valid_moves (current, self->b, new))
+    {
+      fprintf (stderr, "New position is invalid\n");
+      return false;
+    }
+  pieces_set (current, new);
+  return true;
+}
+
+/*
+ * Compute and return the initial or next positions of either the cops
+ * or the robbers
+ */
+pieces *game_next_position (game * self)
+{
+  pieces *current = self->r == COPS ? &(self->cops) : &(self->robbers);
+  size_t *cops = calloc (self->cops.size + 1, sizeof (*cops));
+  size_t *robbers = calloc (self->robbers.size + 1, sizeof (*robbers));
+  size_t *move = calloc (current->size + 1, sizeof (*move));
+  pieces_alive_vertices (&(self->cops), cops);
+  pieces_alive_vertices (&(self->robbers), robbers);
+  if (!current->placed)
+    {
+      // Compute initial positions
+      if (self->tb->states != 0 && self->r == COPS)
+        game_tablebase_place_cops (self, move);
+      else if (self->tb->states != 0)
+        game_tablebase_place_robbers (self, cops, move);
+      else if (self->r == COPS)
+        game_place_cops (self, move);
+      else
+        game_place_robbers (self, cops, move);
+    }
+  else if (self->tb->states != 0 && self->r == COPS)
+    {
+      // Lost positions are all alike in the tablebase, so search instead
+      if (!game_tablebase_move_cops (self, cops, robbers, move))
+        game_mcts_move (self, cops, robbers, move);
+    }
+  else if (self->tb->states != 0)
+    game_tablebase_move_robbers (self, cops, robbers, move);
+  else
+    // Compute next positions
+    game_mcts_move (self, cops, robbers, move);
+  pieces_set (current, move);
+  free (cops);
+  free (robbers);
+  free (move);
   return current;
 }
 
@@ -134,103 +562,486 @@ vector *game_next_position (game * self)
  */
 size_t game_capture_robbers (game * self)
 {
-  if (self->cops.positions == NULL || self->robbers.positions == NULL)
+  if (!self->cops.placed || !self->robbers.placed)
     return UINT_MAX;
-  for (size_t i = 0; i < self->robbers.size; i++)
-    for (size_t j = 0; j < self->cops.size; j++)
-      if (self->robbers.positions[i] == self->cops.positions[j])
-        {
-          fprintf (stderr, "Captured robber at position %zu\n",
-                   self->robbers.positions[i]->index);
-          vector_remove_at (&(self->robbers), i);
-          return game_capture_robbers (self);
-        }
-  return self->robbers.size;
+  uint32_t *captured = calloc (self->robbers.size + 1, sizeof (*captured));
+  size_t count = pieces_capture (&(self->robbers), &(self->cops),
+                                 self->occupied, captured);
+  for (size_t i = 0; i < count; i++)
+    {
+      uint32_t vertex = self->robbers.vertices[captured[i]];
+      fprintf (stderr, "Captured robber at position %u\n", vertex);
+      trace_write (self->t, TRACE_CAPTURE, ROBBERS, game_turn (self) - 1, 0,
+                   &vertex, 1);
+    }
+  free (captured);
+  return self->robbers.alive_size;
 }
 
-size_t *read_positions (size_t len)
+/*
+ * Read len positions and return NULL if they cannot be parsed
+ */
+size_t *read_positions (size_t len, FILE * in)
 {
   size_t *pos = calloc (len, sizeof (*pos));
   for (size_t i = 0; i < len; i++)
     {
       char buffer[100];
-      char *msg = fgets (buffer, sizeof buffer, stdin);
+      char *msg = fgets (buffer, sizeof buffer, in);
       if (msg == NULL || sscanf (buffer, "%zu", &pos[i]) != 1)
         {
           fprintf (stderr, "Error while reading new positions\n");
-          exit (1);
+          free (pos);
+          return NULL;
         }
     }
   return pos;
 }
 
-int main (int argc, const char *argv[])
+/*
+ * Return current time in microseconds
+ */
+uint64_t now_us (void)
 {
-  struct timeval t1;
-  gettimeofday (&t1, NULL);
-  srand (t1.tv_usec * t1.tv_sec);
-  // Initialize game
-  game g;
-  game_create (&g);
-
-  // Initialize data structures
-  if (argc != 3)
-    {
-      fprintf (stderr,
-               "Incorrect number of arguments: ./game filename 0/1\n");
-      exit (-1);
-    }
-  FILE *file = fopen (argv[1], "r");
-  if (file == NULL)
-    {
-      fprintf (stderr, "Error opening input file");
-      exit (-1);
-    }
-  bool success = board_read_from (&(g.b), file);
-  fclose (file);
-  if (!success)
-    {
-      fprintf (stderr, "Error parsing input file");
-      exit (-1);
-    }
-  g.cops.size = g.b.cops;
-  g.robbers.size = g.b.robbers;
-  g.r = atoi (argv[2]);
-  g.remaining_turn = g.b.max_turn + 2;
+  struct timeval t;
+  gettimeofday (&t, NULL);
+  return (uint64_t) t.tv_sec * 1000000 + t.tv_usec;
+}
 
+/*
+ * Play a whole game reading adversary moves from in and writing our
+ * moves to out, return false if the adversary sent invalid moves
+ */
+bool game_play (game * self, FILE * in, FILE * out)
+{
   // Play each turn
   enum role turn = COPS;
-  while (game_capture_robbers (&g) != 0 && g.remaining_turn != 0)
+  while (game_capture_robbers (self) != 0 && self->remaining_turn != 0)
     {
-      if (g.remaining_turn > g.b.max_turn)
+      if (self->remaining_turn > self->b->max_turn)
         fprintf (stderr, "Initial positions for %s\n",
                  turn == COPS ? "cops" : "robbers");
       else
         fprintf (stderr, "Turn for %s (remaining: %zu)\n",
-                 turn == COPS ? "cops" : "robbers", g.remaining_turn);
-      if (turn == g.r)
+                 turn == COPS ? "cops" : "robbers", self->remaining_turn);
+      uint64_t start = now_us ();
+      if (turn == self->r)
         {
           // This is the turn of this program to find new positions
-          vector *pos = game_next_position (&g);
-          vector_print (pos);
+          pieces *pos = game_next_position (self);
+          pieces_print (pos, out);
         }
       else
         {
           // This is the turn of the adversary program to find new
           // positions
-          size_t len = g.r == COPS ? g.robbers.size : g.cops.size;
-          size_t *pos = read_positions (len);
-          game_update_position (&g, pos);
+          size_t len = self->r == COPS ? self->robbers.alive_size :
+            self->cops.alive_size;
+          size_t *pos = read_positions (len, in);
+          bool valid = pos != NULL && game_update_position (self, pos);
           free (pos);
+          if (!valid)
+            return false;
         }
+      game_trace_move (self, turn, now_us () - start);
       turn = turn == COPS ? ROBBERS : COPS;
-      g.remaining_turn--;
+      self->remaining_turn--;
     }
 
   // Finalization
-  if (g.robbers.size != 0)
+  uint32_t winner = self->robbers.alive_size != 0 ? ROBBERS : COPS;
+  if (self->robbers.alive_size != 0)
     fprintf (stderr, "Robbers win!\n");
   else
     fprintf (stderr, "Cops win!\n");
+  trace_write (self->t, TRACE_END, self->r, game_turn (self), 0, &winner, 1);
+  return true;
+}
+
+enum daemon_state
+{ DAEMON_LOADING, DAEMON_READY, DAEMON_FAILED };
+
+/*
+ * Board of the daemon with its loading state, entries are never
+ * removed so that their address stays valid
+ */
+typedef struct
+{
+  char *filename;
+  game_board board;
+  enum daemon_state state;
+} daemon_entry;
+
+/*
+ * Boards shared by all matches of the daemon, loaded on first use.
+ * The lock only protects the list and states, loading is done without
+ * it and signaled through loaded.
+ */
+typedef struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t loaded;
+  daemon_entry **entries;
+  size_t size;
+} daemon_boards;
+
+/*
+ * Accepted connections waiting for a worker, idle workers waiting for
+ * a connection and active ones playing a match
+ */
+typedef struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  int *fds;
+  size_t head;
+  size_t size;
+  size_t capacity;
+  daemon_boards *boards;
+  const char *trace;
+  size_t matches;
+  size_t workers;
+  size_t max_workers;
+  size_t idle;
+  size_t active;
+  size_t processors;
+} daemon_queue;
+
+/*
+ * Return the board loaded from filename, loading it if this is the
+ * first match on it or waiting for the match loading it, or NULL if it
+ * cannot be loaded. Loading after a failure is tried again.
+ */
+game_board *daemon_board (daemon_boards * self, const char *filename,
+                          size_t threads)
+{
+  pthread_mutex_lock (&(self->lock));
+  daemon_entry *found = NULL;
+  for (size_t i = 0; i < self->size && found == NULL; i++)
+    if (strcmp (self->entries[i]->filename, filename) == 0)
+      found = self->entries[i];
+  if (found == NULL)
+    {
+      found = calloc (1, sizeof (*found));
+      found->filename = malloc (strlen (filename) + 1);
+      strcpy (found->filename, filename);
+      found->state = DAEMON_FAILED;
+      self->entries = realloc (self->entries, (self->size + 1)
+                               * sizeof (*self->entries));
+      self->entries[self->size++] = found;
+    }
+  while (found->state == DAEMON_LOADING)
+    pthread_cond_wait (&(self->loaded), &(self->lock));
+  if (found->state == DAEMON_FAILED)
+    {
+      found->state = DAEMON_LOADING;
+      pthread_mutex_unlock (&(self->lock));
+      bool success = game_board_load (&(found->board), filename, threads);
+      if (!success)
+        game_board_destroy (&(found->board));
+      pthread_mutex_lock (&(self->lock));
+      found->state = success ? DAEMON_READY : DAEMON_FAILED;
+      pthread_cond_broadcast (&(self->loaded));
+    }
+  game_board *board = found->state == DAEMON_READY ? &(found->board) : NULL;
+  pthread_mutex_unlock (&(self->lock));
+  return board;
+}
+
+/*
+ * Play one match on a connection whose first line is "filename 0/1",
+ * answered by "OK" once the board is loaded (or an error line) and
+ * followed by the same protocol as stdin and stdout, planners using
+ * threads threads
+ */
+void daemon_match (daemon_queue * queue, int fd, size_t id, size_t threads)
+{
+  int out_fd = dup (fd);
+  FILE *in = fdopen (fd, "r");
+  FILE *out = out_fd < 0 ? NULL : fdopen (out_fd, "w");
+  char line[4096 + 16];
+  char filename[4096];
+  int r;
+  if (in == NULL || out == NULL || fgets (line, sizeof (line), in) == NULL
+      || sscanf (line, "%4095s %d", filename, &r) != 2 || (r != COPS
+                                                           && r != ROBBERS))
+    fprintf (stderr, "Match %zu: invalid header\n", id);
+  else
+    {
+      game_board *shared = daemon_board (queue->boards, filename, threads);
+      fprintf (out, shared != NULL ? "OK\n" : "Error loading %s\n",
+               filename);
+      fflush (out);
+      if (shared != NULL)
+        {
+          game g;
+          game_create (&g, shared, r);
+          g.threads = threads;
+          if (queue->trace != NULL)
+            {
+              char path[4096 + 32];
+              snprintf (path, sizeof (path), "%s.%zu", queue->trace, id);
+              game_open_trace (&g, path);
+            }
+          if (!game_play (&g, in, out))
+            fprintf (stderr, "Match %zu: invalid adversary moves\n", id);
+          game_destroy (&g);
+        }
+    }
+  if (in != NULL)
+    fclose (in);
+  else
+    close (fd);
+  if (out != NULL)
+    fclose (out);
+  else if (out_fd >= 0)
+    close (out_fd);
+}
+
+void *daemon_worker (void *arg)
+{
+  daemon_queue *queue = arg;
+  while (true)
+    {
+      pthread_mutex_lock (&(queue->lock));
+      while (queue->size == 0)
+        pthread_cond_wait (&(queue->ready), &(queue->lock));
+      queue->idle--;
+      int fd = queue->fds[queue->head];
+      queue->head = (queue->head + 1) % queue->capacity;
+      queue->size--;
+      size_t id = queue->matches++;
+      // Processors are shared between the matches being played
+      queue->active++;
+      size_t threads = queue->processors / queue->active;
+      pthread_mutex_unlock (&(queue->lock));
+      daemon_match (queue, fd, id, threads > 0 ? threads : 1);
+      pthread_mutex_lock (&(queue->lock));
+      queue->active--;
+      queue->idle++;
+      pthread_mutex_unlock (&(queue->lock));
+    }
+  return NULL;
+}
+
+/*
+ * Serve matches on a Unix socket, each match keeping one worker thread
+ * busy until it ends. Workers are started when no idle one is left, up
+ * to workers, and further connections are refused with an error line.
+ */
+int daemon_run (const char *path, size_t workers)
+{
+  int server = socket (AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un address;
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  if (server < 0 || strlen (path) >= sizeof (address.sun_path))
+    {
+      fprintf (stderr, "Error creating socket %s\n", path);
+      return 1;
+    }
+  strcpy (address.sun_path, path);
+  unlink (path);
+  if (bind (server, (struct sockaddr *) &address, sizeof (address)) != 0
+      || listen (server, SOMAXCONN) != 0)
+    {
+      fprintf (stderr, "Error listening on %s\n", path);
+      close (server);
+      return 1;
+    }
+  // Writing to a closed connection must only end that match
+  signal (SIGPIPE, SIG_IGN);
+
+  daemon_boards boards;
+  pthread_mutex_init (&(boards.lock), NULL);
+  pthread_cond_init (&(boards.loaded), NULL);
+  boards.entries = NULL;
+  boards.size = 0;
+  daemon_queue queue;
+  pthread_mutex_init (&(queue.lock), NULL);
+  pthread_cond_init (&(queue.ready), NULL);
+  queue.capacity = 64;
+  queue.fds = calloc (queue.capacity, sizeof (*queue.fds));
+  queue.head = 0;
+  queue.size = 0;
+  queue.boards = &boards;
+  queue.trace = getenv ("GAME_TRACE");
+  queue.matches = 0;
+  queue.workers = 0;
+  queue.max_workers = workers;
+  queue.idle = 0;
+  queue.active = 0;
+  long online = sysconf (_SC_NPROCESSORS_ONLN);
+  queue.processors = online > 0 ? (size_t) online : 1;
+  fprintf (stderr, "Serving matches on %s with up to %zu workers\n", path,
+           workers);
+
+  while (true)
+    {
+      int fd = accept (server, NULL, NULL);
+      if (fd < 0)
+        continue;
+      pthread_mutex_lock (&(queue.lock));
+      if (queue.idle <= queue.size)
+        {
+          pthread_t id;
+          if (queue.workers < queue.max_workers
+              && pthread_create (&id, NULL, daemon_worker, &queue) == 0)
+            {
+              // The new worker counts as idle until it takes fd
+              pthread_detach (id);
+              queue.workers++;
+              queue.idle++;
+            }
+          else
+            {
+              size_t busy = queue.workers;
+              pthread_mutex_unlock (&(queue.lock));
+              fprintf (stderr, "Refused a match, %zu workers are busy\n",
+                       busy);
+              const char error[] = "Error: every worker is busy\n";
+              if (write (fd, error, sizeof (error) - 1) < 0)
+                fprintf (stderr, "Could not answer refused match\n");
+              close (fd);
+              continue;
+            }
+        }
+      if (queue.size == queue.capacity)
+        {
+          // Grow the ring buffer, unwrapping it at the same time
+          int *fds = calloc (2 * queue.capacity, sizeof (*fds));
+          for (size_t i = 0; i < queue.size; i++)
+            fds[i] = queue.fds[(queue.head + i) % queue.capacity];
+          free (queue.fds);
+          queue.fds = fds;
+          queue.head = 0;
+          queue.capacity *= 2;
+        }
+      queue.fds[(queue.head + queue.size) % queue.capacity] = fd;
+      queue.size++;
+      pthread_cond_signal (&(queue.ready));
+      pthread_mutex_unlock (&(queue.lock));
+    }
+  return 0;
+}
+
+/*
+ * Forward a match to the daemon listening on path: send the header
+ * then relay stdin to the socket and the socket to stdout. Return -1
+ * if the daemon did not start the match, which can then be played
+ * here.
+ */
+int daemon_connect (const char *path, const char *filename, const char *r)
+{
+  int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  struct sockaddr_un address;
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  char absolute[PATH_MAX];
+  if (fd < 0 || strlen (path) >= sizeof (address.sun_path)
+      || realpath (filename, absolute) == NULL)
+    {
+      fprintf (stderr, "Error connecting to %s\n", path);
+      return -1;
+    }
+  strcpy (address.sun_path, path);
+  if (connect (fd, (struct sockaddr *) &address, sizeof (address)) != 0)
+    {
+      fprintf (stderr, "Error connecting to %s\n", path);
+      close (fd);
+      return -1;
+    }
+  char header[PATH_MAX + 16];
+  int length = snprintf (header, sizeof (header), "%s %d\n", absolute,
+                         atoi (r));
+  if (write (fd, header, length) != length)
+    {
+      close (fd);
+      return -1;
+    }
+  // The daemon answers OK or an error line before the match starts
+  char answer[128];
+  size_t used = 0;
+  while (used + 1 < sizeof (answer)
+         && read (fd, answer + used, 1) == 1 && answer[used] != '\n')
+    used++;
+  answer[used] = '\0';
+  if (strcmp (answer, "OK") != 0)
+    {
+      fprintf (stderr, "Daemon %s did not start the match: %s\n", path,
+               answer);
+      close (fd);
+      return -1;
+    }
+
+  struct pollfd fds[2] = { {STDIN_FILENO, POLLIN, 0}, {fd, POLLIN, 0} };
+  char buffer[4096];
+  while (true)
+    {
+      if (poll (fds, 2, -1) < 0)
+        break;
+      if (fds[0].revents & (POLLIN | POLLHUP))
+        {
+          ssize_t n = read (STDIN_FILENO, buffer, sizeof (buffer));
+          if (n <= 0)
+            {
+              // The adversary is gone, let the daemon see end of file
+              shutdown (fd, SHUT_WR);
+              fds[0].fd = -1;
+            }
+          else if (write (fd, buffer, n) != n)
+            break;
+        }
+      if (fds[1].revents & (POLLIN | POLLHUP))
+        {
+          ssize_t n = read (fd, buffer, sizeof (buffer));
+          if (n <= 0 || write (STDOUT_FILENO, buffer, n) != n)
+            break;
+        }
+    }
+  close (fd);
+  return 0;
+}
+
+int main (int argc, const char *argv[])
+{
+  struct timeval t1;
+  gettimeofday (&t1, NULL);
+  srand (t1.tv_usec * t1.tv_sec);
+
+  if (argc >= 3 && strcmp (argv[1], "--daemon") == 0)
+    {
+      size_t workers = argc > 3 ? (size_t) atoi (argv[3]) : GAME_WORKERS;
+      return daemon_run (argv[2], workers > 0 ? workers : 1);
+    }
+
+  // Initialize data structures
+  if (argc != 3)
+    {
+      fprintf (stderr,
+               "Incorrect number of arguments: ./game filename 0/1\n"
+               "or ./game --daemon socket [workers]\n");
+      exit (-1);
+    }
+  // Play the match here if the daemon cannot start it
+  const char *socket_path = getenv ("GAME_DAEMON");
+  if (socket_path != NULL
+      && daemon_connect (socket_path, argv[1], argv[2]) == 0)
+    return 0;
+
+  game_board shared;
+  if (!game_board_load (&shared, argv[1], 0))
+    exit (-1);
+  // Initialize game
+  game g;
+  game_create (&g, &shared, atoi (argv[2]));
+  const char *filename = getenv ("GAME_TRACE");
+  if (filename != NULL)
+    game_open_trace (&g, filename);
+
+  bool success = game_play (&g, stdin, stdout);
   game_destroy (&g);
+  game_board_destroy (&shared);
+  if (!success)
+    exit (1);
 }
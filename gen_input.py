@@ -1,7 +1,7 @@
 import math
 
 
-def print_input(filename, positions, edges):
+def print_input(filename, positions, edges, weights=None):
     ROBBERS = 3
     with open(filename, "w") as f:
         f.write(f"Cops: 3\n")
@@ -11,8 +11,11 @@ def print_input(filename, positions, edges):
         for x, y in positions:
             f.write(f"{x:.3f} {y:.3f}\n")
         f.write(f"Edges: {len(edges)}\n")
-        for i, j in edges:
-            f.write(f"{i} {j}\n")
+        for k, (i, j) in enumerate(edges):
+            if weights is None:
+                f.write(f"{i} {j}\n")
+            else:
+                f.write(f"{i} {j} {weights[k]}\n")
 
 
 def gen_indep(vertex):
@@ -127,6 +130,16 @@ def gen_hexa_order(order):
     return positions, edges
 
 
+def gen_terrain(positions, edges):
+    # Terrain cost grows with the height of the middle of each edge
+    weights = []
+    for i, j in edges:
+        x = (positions[i][0] + positions[j][0]) / 2
+        y = (positions[i][1] + positions[j][1]) / 2
+        weights.append(1 + round(4 * (1 + math.sin(3 * x) * math.cos(2 * y))))
+    return positions, edges, weights
+
+
 print_input("inputs/indep1.txt", *gen_indep(3))
 print_input("inputs/indep3.txt", *gen_indep(3))
 print_input("inputs/indep4.txt", *gen_indep(4))
@@ -137,3 +150,5 @@ print_input("inputs/circular50.txt", *gen_circular_chain(50))
 print_input("inputs/hexa3.txt", *gen_hexa_order(3))
 print_input("inputs/hexa10.txt", *gen_hexa_order(10))
 print_input("inputs/hexa20.txt", *gen_hexa_order(20))
+print_input("inputs/terrain10.txt", *gen_terrain(*gen_hexa_order(10)))
+print_input("inputs/terrain20.txt", *gen_terrain(*gen_hexa_order(20)))
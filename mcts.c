@@ -0,0 +1,465 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "mcts.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Tree node, children of a node are linked through sibling and node 0
+ * is the root so 0 also means no node
+ */
+typedef struct
+{
+  uint32_t visits;
+  uint32_t action;
+  uint32_t child;
+  uint32_t sibling;
+  uint32_t expanded;
+  float value;
+} mcts_node;
+
+/*
+ * Position during a playout, robbers only holds robbers not captured
+ * and ids their index in the root position
+ */
+typedef struct
+{
+  size_t *cops;
+  size_t cops_size;
+  size_t *robbers;
+  size_t *ids;
+  size_t robbers_size;
+  size_t initial_robbers;
+  enum role turn;
+  size_t remaining;
+} mcts_state;
+
+typedef struct
+{
+  mcts_position *root;
+  double deadline;
+  uint64_t seed;
+  mcts_node *nodes;
+  size_t used;
+  size_t playouts;
+  uint32_t *root_visits;
+  uint32_t *path;
+  mcts_state state;
+  size_t *move;
+} mcts_worker;
+
+static double mcts_now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*
+ * xorshift64* generator, seed must not be 0
+ */
+static uint64_t mcts_random (uint64_t * seed)
+{
+  *seed ^= *seed >> 12;
+  *seed ^= *seed << 25;
+  *seed ^= *seed >> 27;
+  return *seed * 2685821657736338717ULL;
+}
+
+static double mcts_uniform (uint64_t * seed)
+{
+  return (mcts_random (seed) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * Return the number of joint moves of pieces, MCTS_MAX_ACTIONS + 1 if
+ * there are more
+ */
+static size_t mcts_actions (board * b, const size_t *pieces, size_t size)
+{
+  size_t actions = 1;
+  for (size_t i = 0; i < size; i++)
+    {
+      actions *= b->vertices[pieces[i]]->degree + 1;
+      if (actions > MCTS_MAX_ACTIONS)
+        return MCTS_MAX_ACTIONS + 1;
+    }
+  return actions;
+}
+
+/*
+ * Write in move the joint move number action of pieces, each digit
+ * being a neighbor index or the degree to stay
+ */
+static void mcts_decode (board * b, const size_t *pieces, size_t size,
+                         size_t action, size_t *move)
+{
+  for (size_t i = 0; i < size; i++)
+    {
+      board_vertex *v = b->vertices[pieces[i]];
+      size_t digit = action % (v->degree + 1);
+      action /= v->degree + 1;
+      move[i] = digit < v->degree ? v->neighbors[digit]->index : pieces[i];
+    }
+}
+
+/*
+ * Return a random vertex among the neighbors of vertex and itself
+ */
+static size_t mcts_random_step (board * b, size_t vertex, uint64_t * seed)
+{
+  board_vertex *v = b->vertices[vertex];
+  size_t digit = mcts_random (seed) % (v->degree + 1);
+  return digit < v->degree ? v->neighbors[digit]->index : vertex;
+}
+
+/*
+ * Rollout policy on raw arrays: cops step toward their assigned robber
+ * or the closest one if it was captured, robbers step to the vertex
+ * farthest from every cop. ids gives the root index of each robber
+ * (NULL at the root)
+ */
+static void mcts_policy_pieces (board * b, enum role turn,
+                                const size_t *cops, size_t cops_size,
+                                const size_t *robbers, size_t robbers_size,
+                                const size_t *targets, const size_t *ids,
+                                double greedy, uint64_t * seed, size_t *move)
+{
+  if (turn == COPS)
+    {
+      for (size_t i = 0; i < cops_size; i++)
+        {
+          size_t target = cops[i], best = BOARD_UNREACHABLE;
+          for (size_t j = 0; j < robbers_size; j++)
+            {
+              size_t d = board_dist (b, cops[i], robbers[j]);
+              bool assigned = targets != NULL && d != BOARD_UNREACHABLE
+                && targets[i] == (ids != NULL ? ids[j] : j);
+              if (d < best || assigned)
+                {
+                  best = d;
+                  target = robbers[j];
+                }
+              if (assigned)
+                break;
+            }
+          if (best != BOARD_UNREACHABLE && mcts_uniform (seed) < greedy)
+            move[i] = best == 0 ? cops[i] : board_next (b, cops[i], target);
+          else
+            move[i] = mcts_random_step (b, cops[i], seed);
+        }
+      return;
+    }
+
+  for (size_t i = 0; i < robbers_size; i++)
+    {
+      if (mcts_uniform (seed) >= greedy)
+        {
+          move[i] = mcts_random_step (b, robbers[i], seed);
+          continue;
+        }
+      board_vertex *v = b->vertices[robbers[i]];
+      size_t best = 0;
+      move[i] = robbers[i];
+      for (size_t k = 0; k <= v->degree; k++)
+        {
+          size_t candidate = k < v->degree ? v->neighbors[k]->index :
+            robbers[i];
+          size_t closest = BOARD_UNREACHABLE;
+          for (size_t j = 0; j < cops_size; j++)
+            {
+              size_t d = board_dist (b, candidate, cops[j]);
+              closest = d < closest ? d : closest;
+            }
+          if (closest > best)
+            {
+              best = closest;
+              move[i] = candidate;
+            }
+        }
+    }
+}
+
+void mcts_policy (mcts_position * position, double greedy, uint64_t * seed,
+                  size_t *move)
+{
+  mcts_policy_pieces (position->b, position->turn, position->cops,
+                      position->cops_size, position->robbers,
+                      position->robbers_size, position->targets, NULL,
+                      greedy, seed, move);
+}
+
+/*
+ * Play move for the side to move and remove captured robbers
+ */
+static void mcts_apply (mcts_state * state, const size_t *move)
+{
+  if (state->turn == COPS)
+    memcpy (state->cops, move, state->cops_size * sizeof (*move));
+  else
+    memcpy (state->robbers, move, state->robbers_size * sizeof (*move));
+  for (size_t j = 0; j < state->robbers_size;)
+    {
+      bool captured = false;
+      for (size_t i = 0; i < state->cops_size && !captured; i++)
+        captured = state->cops[i] == state->robbers[j];
+      if (captured)
+        {
+          state->robbers_size--;
+          state->robbers[j] = state->robbers[state->robbers_size];
+          state->ids[j] = state->ids[state->robbers_size];
+        }
+      else
+        j++;
+    }
+  state->turn = state->turn == COPS ? ROBBERS : COPS;
+  state->remaining--;
+}
+
+static bool mcts_terminal (mcts_state * state)
+{
+  return state->robbers_size == 0 || state->remaining == 0;
+}
+
+/*
+ * Reward of a final state for the cops: half for the fraction of
+ * captured robbers and half for capturing all of them
+ */
+static float mcts_reward (mcts_state * state)
+{
+  if (state->initial_robbers == 0)
+    return 1;
+  float captured = (float) (state->initial_robbers - state->robbers_size)
+    / state->initial_robbers;
+  return 0.5f * captured + (state->robbers_size == 0 ? 0.5f : 0.0f);
+}
+
+static size_t mcts_pieces (mcts_state * state, const size_t **pieces)
+{
+  *pieces = state->turn == COPS ? state->cops : state->robbers;
+  return state->turn == COPS ? state->cops_size : state->robbers_size;
+}
+
+/*
+ * Order in which children are expanded, a stride coprime with the
+ * number of actions so that every action is eventually tried
+ */
+static size_t mcts_expansion (size_t expanded, size_t actions)
+{
+  size_t stride = actions % 7919 == 0 ? 1 : 7919;
+  return (expanded * stride) % actions;
+}
+
+/*
+ * Select down the tree with UCT, expand one child, play the rollout
+ * policy to the end and back up the reward
+ */
+static void mcts_playout (mcts_worker * self)
+{
+  mcts_position *root = self->root;
+  mcts_state *state = &(self->state);
+  board *b = root->b;
+  memcpy (state->cops, root->cops, root->cops_size * sizeof (size_t));
+  memcpy (state->robbers, root->robbers,
+          root->robbers_size * sizeof (size_t));
+  for (size_t j = 0; j < root->robbers_size; j++)
+    state->ids[j] = j;
+  state->cops_size = root->cops_size;
+  state->robbers_size = root->robbers_size;
+  state->initial_robbers = root->robbers_size;
+  state->turn = root->turn;
+  state->remaining = root->remaining;
+
+  size_t depth = 0;
+  uint32_t current = 0;
+  self->path[depth++] = current;
+  while (!mcts_terminal (state))
+    {
+      mcts_node *node = &(self->nodes[current]);
+      const size_t *pieces;
+      size_t size = mcts_pieces (state, &pieces);
+      size_t actions = mcts_actions (b, pieces, size);
+      if (actions > MCTS_MAX_ACTIONS)
+        break;
+      if (node->expanded < actions && self->used < MCTS_NODES)
+        {
+          // Expand a new child and continue with a rollout
+          uint32_t child = self->used++;
+          mcts_node *next = &(self->nodes[child]);
+          memset (next, 0, sizeof (*next));
+          next->action = mcts_expansion (node->expanded, actions);
+          next->sibling = node->child;
+          node->child = child;
+          node->expanded++;
+          mcts_decode (b, pieces, size, next->action, self->move);
+          mcts_apply (state, self->move);
+          self->path[depth++] = child;
+          break;
+        }
+      if (node->child == 0)
+        break;
+      // Every child exists or the pool is full, select with UCT
+      double log_visits = log (node->visits + 1.0);
+      double best = -1;
+      uint32_t chosen = node->child;
+      for (uint32_t c = node->child; c != 0; c = self->nodes[c].sibling)
+        {
+          mcts_node *child = &(self->nodes[c]);
+          double q = child->value / (child->visits + 1e-9);
+          if (state->turn == ROBBERS)
+            q = 1 - q;
+          double score = child->visits == 0 ? 1e9 : q + MCTS_EXPLORATION
+            * sqrt (log_visits / child->visits);
+          if (score > best)
+            {
+              best = score;
+              chosen = c;
+            }
+        }
+      mcts_decode (b, pieces, size, self->nodes[chosen].action, self->move);
+      mcts_apply (state, self->move);
+      current = chosen;
+      self->path[depth++] = current;
+    }
+
+  current = self->path[depth - 1];
+  while (!mcts_terminal (state))
+    {
+      mcts_policy_pieces (b, state->turn, state->cops, state->cops_size,
+                          state->robbers, state->robbers_size, root->targets,
+                          state->ids, MCTS_GREEDY, &(self->seed), self->move);
+      mcts_apply (state, self->move);
+    }
+
+  float reward = mcts_reward (state);
+  for (size_t i = 0; i < depth; i++)
+    {
+      self->nodes[self->path[i]].visits++;
+      self->nodes[self->path[i]].value += reward;
+    }
+  self->playouts++;
+}
+
+static void *mcts_run (void *arg)
+{
+  mcts_worker *self = arg;
+  memset (&(self->nodes[0]), 0, sizeof (mcts_node));
+  self->used = 1;
+  do
+    {
+      for (size_t i = 0; i < 16; i++)
+        mcts_playout (self);
+    }
+  while (mcts_now () < self->deadline);
+  for (uint32_t c = self->nodes[0].child; c != 0; c = self->nodes[c].sibling)
+    self->root_visits[self->nodes[c].action] += self->nodes[c].visits;
+  return NULL;
+}
+
+void mcts_search (mcts_position * position, double seconds, size_t threads,
+                  size_t *move, mcts_stats * stats)
+{
+  double start = mcts_now ();
+  const size_t *pieces = position->turn == COPS ? position->cops :
+    position->robbers;
+  size_t size = position->turn == COPS ? position->cops_size :
+    position->robbers_size;
+  size_t actions = mcts_actions (position->b, pieces, size);
+  uint64_t seed = (uint64_t) (start * 1e9) | 1;
+  if (stats != NULL)
+    {
+      stats->playouts = 0;
+      stats->seconds = 0;
+      stats->threads = 0;
+    }
+  if (actions > MCTS_MAX_ACTIONS || position->remaining == 0
+      || position->robbers_size == 0)
+    {
+      mcts_policy (position, 1, &seed, move);
+      return;
+    }
+  if (threads == 0)
+    {
+      long online = sysconf (_SC_NPROCESSORS_ONLN);
+      threads = online > 0 ? (size_t) online : 1;
+    }
+
+  mcts_worker *workers = calloc (threads, sizeof (*workers));
+  pthread_t *ids = calloc (threads, sizeof (*ids));
+  bool *started = calloc (threads, sizeof (*started));
+  uint32_t *visits = calloc (threads * actions, sizeof (*visits));
+  size_t pieces_size = position->cops_size > position->robbers_size ?
+    position->cops_size : position->robbers_size;
+  for (size_t t = 0; t < threads; t++)
+    {
+      mcts_worker *w = &(workers[t]);
+      w->root = position;
+      w->deadline = start + seconds;
+      w->seed = seed + 0x9E3779B97F4A7C15ULL * (t + 1);
+      w->seed = w->seed == 0 ? 1 : w->seed;
+      w->nodes = malloc (MCTS_NODES * sizeof (*w->nodes));
+      w->root_visits = visits + t * actions;
+      w->path = calloc (position->remaining + 2, sizeof (*w->path));
+      w->state.cops = calloc (position->cops_size + 1, sizeof (size_t));
+      w->state.robbers = calloc (position->robbers_size + 1, sizeof (size_t));
+      w->state.ids = calloc (position->robbers_size + 1, sizeof (size_t));
+      w->move = calloc (pieces_size + 1, sizeof (size_t));
+      // The calling thread runs the last tree
+      started[t] = t + 1 < threads
+        && pthread_create (&ids[t], NULL, mcts_run, w) == 0;
+    }
+  // A tree whose thread could not be created is left empty
+  mcts_run (&(workers[threads - 1]));
+
+  size_t playouts = 0;
+  for (size_t t = 0; t < threads; t++)
+    {
+      if (started[t])
+        pthread_join (ids[t], NULL);
+      playouts += workers[t].playouts;
+    }
+
+  // Merge root visit counts of every tree
+  size_t best = 0, best_visits = 0;
+  for (size_t a = 0; a < actions; a++)
+    {
+      size_t total = 0;
+      for (size_t t = 0; t < threads; t++)
+        total += visits[t * actions + a];
+      if (total > best_visits)
+        {
+          best_visits = total;
+          best = a;
+        }
+    }
+  if (best_visits == 0)
+    mcts_policy (position, 1, &seed, move);
+  else
+    mcts_decode (position->b, pieces, size, best, move);
+
+  if (stats != NULL)
+    {
+      stats->playouts = playouts;
+      stats->seconds = mcts_now () - start;
+      stats->threads = threads;
+    }
+  for (size_t t = 0; t < threads; t++)
+    {
+      free (workers[t].nodes);
+      free (workers[t].path);
+      free (workers[t].state.cops);
+      free (workers[t].state.robbers);
+      free (workers[t].state.ids);
+      free (workers[t].move);
+    }
+  free (workers);
+  free (ids);
+  free (started);
+  free (visits);
+}
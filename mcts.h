@@ -0,0 +1,72 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "algo.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Largest number of joint moves searched at the root, bigger sides
+ * only play the rollout policy
+ */
+#define MCTS_MAX_ACTIONS 65536
+
+/*
+ * Number of nodes of the tree of each thread
+ */
+#define MCTS_NODES ((size_t) 1 << 18)
+
+/*
+ * Exploration constant of the UCT formula
+ */
+#define MCTS_EXPLORATION 0.7
+
+/*
+ * Probability that a rollout move follows the distance heuristic
+ * instead of being random
+ */
+#define MCTS_GREEDY 0.85
+
+/*
+ * Position searched from, remaining is the number of moves left
+ * including the one to play and targets the index of the robber each
+ * cop chases in rollouts (NULL or SIZE_MAX for the closest one)
+ */
+typedef struct
+{
+  board *b;
+  size_t cops_size;
+  const size_t *cops;
+  size_t robbers_size;
+  const size_t *robbers;
+  enum role turn;
+  size_t remaining;
+  const size_t *targets;
+} mcts_position;
+
+typedef struct
+{
+  size_t playouts;
+  double seconds;
+  size_t threads;
+} mcts_stats;
+
+/*
+ * Search the joint move of the side to move for the given number of
+ * seconds with one tree per thread (threads = 0 for one per online
+ * processor), merge root visit counts and write the new position of
+ * each piece of the side to move in move
+ */
+void mcts_search (mcts_position * position, double seconds, size_t threads,
+                  size_t *move, mcts_stats * stats);
+
+/*
+ * Write in move the position of each piece of the side to move after
+ * one step of the rollout policy, greedy being the probability to
+ * follow the distance heuristic and seed the random state
+ */
+void mcts_policy (mcts_position * position, double greedy, uint64_t * seed,
+                  size_t *move);
+
+#endif // MCTS_H
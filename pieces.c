@@ -0,0 +1,100 @@
+#include "pieces.h"
+
+#include <stdlib.h>
+
+void pieces_create (pieces * self, size_t size)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  self->size = size;
+  self->alive_size = size;
+  self->placed = false;
+  self->vertices = calloc (size + 1, sizeof (*self->vertices));
+  self->alive = calloc (size + 1, sizeof (*self->alive));
+  for (size_t i = 0; i < size; i++)
+    self->alive[i] = true;
+}
+
+void pieces_destroy (pieces * self)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  free (self->vertices);
+  free (self->alive);
+  self->vertices = NULL;
+  self->alive = NULL;
+  self->size = 0;
+  self->alive_size = 0;
+}
+
+size_t pieces_alive_vertices (const pieces * self, size_t *vertices)
+{
+  size_t k = 0;
+  for (size_t i = 0; i < self->size; i++)
+    if (self->alive[i])
+      vertices[k++] = self->vertices[i];
+  return k;
+}
+
+void pieces_set (pieces * self, const size_t *vertices)
+{
+  size_t k = 0;
+  for (size_t i = 0; i < self->size; i++)
+    if (self->alive[i])
+      self->vertices[i] = vertices[k++];
+  self->placed = true;
+}
+
+bool pieces_valid_moves (const pieces * self, board * b,
+                         const size_t *vertices)
+{
+  size_t k = 0;
+  for (size_t i = 0; i < self->size; i++)
+    {
+      if (!self->alive[i])
+        continue;
+      size_t to = vertices[k++];
+      if (to >= b->size || (self->placed
+                            && !board_is_valid_move (b, self->vertices[i],
+                                                     to)))
+        return false;
+    }
+  return true;
+}
+
+size_t pieces_capture (pieces * robbers, const pieces * cops,
+                       uint8_t * occupied, uint32_t * captured)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < cops->size; i++)
+    if (cops->alive[i])
+      occupied[cops->vertices[i]] = 1;
+  for (size_t i = 0; i < robbers->size; i++)
+    if (robbers->alive[i] && occupied[robbers->vertices[i]])
+      {
+        robbers->alive[i] = false;
+        robbers->alive_size--;
+        if (captured != NULL)
+          captured[count] = i;
+        count++;
+      }
+  for (size_t i = 0; i < cops->size; i++)
+    occupied[cops->vertices[i]] = 0;
+  return count;
+}
+
+void pieces_print (const pieces * self, FILE * out)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  for (size_t i = 0; i < self->size; i++)
+    if (self->alive[i])
+      fprintf (out, "%u\n", self->vertices[i]);
+  fflush (out);
+}
@@ -0,0 +1,68 @@
+#ifndef PIECES_H
+#define PIECES_H
+
+#include "algo.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Pieces of one side as parallel arrays indexed by a stable id: the
+ * vertex of each piece and whether it is still alive. Captured pieces
+ * keep their id, so alive pieces are always listed in id order, which
+ * is the order of the protocol.
+ */
+typedef struct
+{
+  size_t size;
+  size_t alive_size;
+  bool placed;
+  uint32_t *vertices;
+  bool *alive;
+} pieces;
+
+/*
+ * Create size alive pieces not placed yet
+ */
+void pieces_create (pieces * self, size_t size);
+
+/*
+ * Destroy pieces by freeing their arrays
+ */
+void pieces_destroy (pieces * self);
+
+/*
+ * Write the vertex of each alive piece in id order and return their
+ * number
+ */
+size_t pieces_alive_vertices (const pieces * self, size_t *vertices);
+
+/*
+ * Place the alive pieces in id order on vertices
+ */
+void pieces_set (pieces * self, const size_t *vertices);
+
+/*
+ * Return true if each alive piece can move to the vertex at its rank
+ * in vertices, any vertex of b being valid if the pieces are not
+ * placed yet
+ */
+bool pieces_valid_moves (const pieces * self, board * b,
+                         const size_t *vertices);
+
+/*
+ * Kill the alive robbers standing on the vertex of an alive cop, using
+ * occupied as a zeroed scratch array of one byte per vertex that is
+ * zeroed again on return. Write the ids of the captured robbers in
+ * captured if not NULL and return their number.
+ */
+size_t pieces_capture (pieces * robbers, const pieces * cops,
+                       uint8_t * occupied, uint32_t * captured);
+
+/*
+ * Print the vertex of each alive piece in id order, one per line
+ */
+void pieces_print (const pieces * self, FILE * out);
+
+#endif // PIECES_H
@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Moves taking at least this fraction of the timeout are near misses
+ */
+#define REPLAY_NEAR_MISS 0.9
+
+#define REPLAY_MAX_TURN 1024
+
+typedef struct
+{
+  size_t matches;
+  size_t moves;
+  size_t side_moves[2];
+  size_t captures;
+  size_t wins[2];
+  size_t near_misses[2];
+  size_t timeouts[2];
+  uint64_t latency_sum[2];
+  uint32_t latency_max[2];
+  size_t capture_turns[REPLAY_MAX_TURN];
+  size_t corrupted;
+} replay_stats;
+
+/*
+ * Return the bit mask of the writers of a mapped trace
+ */
+unsigned int replay_writers (const unsigned char *data, size_t size)
+{
+  unsigned int writers = 0;
+  size_t offset = 2 * sizeof (uint32_t);
+  while (offset + sizeof (trace_record) <= size)
+    {
+      trace_record record;
+      memcpy (&record, data + offset, sizeof (record));
+      offset += sizeof (record) + (size_t) record.count * sizeof (uint32_t);
+      if (record.writer <= TRACE_WRITER_ROBBERS)
+        writers |= 1u << record.writer;
+    }
+  return writers;
+}
+
+/*
+ * Scan every record of a mapped trace and accumulate statistics. When
+ * several programs traced the same matches, each event is counted once:
+ * moves of a side from the player of that side, other records from
+ * the first writer among the server, the cops and the robbers.
+ */
+void replay_scan (replay_stats * stats, const unsigned char *data,
+                  size_t size)
+{
+  uint32_t near_miss = REPLAY_NEAR_MISS * TRACE_TIMEOUT_US;
+  unsigned int writers = replay_writers (data, size);
+  unsigned int primary = 0;
+  while (writers != 0 && !(writers & (1u << primary)))
+    primary++;
+  size_t offset = 2 * sizeof (uint32_t);
+  while (offset + sizeof (trace_record) <= size)
+    {
+      trace_record record;
+      memcpy (&record, data + offset, sizeof (record));
+      offset += sizeof (record) + (size_t) record.count * sizeof (uint32_t);
+      if (offset > size || record.side > 1
+          || record.writer > TRACE_WRITER_ROBBERS)
+        {
+          stats->corrupted++;
+          return;
+        }
+      unsigned int player = record.side == 0 ? TRACE_WRITER_COPS :
+        TRACE_WRITER_ROBBERS;
+      unsigned int owner = record.type == TRACE_MOVE
+        && (writers & (1u << player)) ? player : primary;
+      if (record.writer != owner)
+        continue;
+      switch (record.type)
+        {
+        case TRACE_MATCH:
+          stats->matches++;
+          break;
+        case TRACE_MOVE:
+          stats->moves++;
+          stats->side_moves[record.side]++;
+          stats->latency_sum[record.side] += record.latency;
+          if (record.latency > stats->latency_max[record.side])
+            stats->latency_max[record.side] = record.latency;
+          if (record.latency >= TRACE_TIMEOUT_US)
+            stats->timeouts[record.side]++;
+          else if (record.latency >= near_miss)
+            stats->near_misses[record.side]++;
+          break;
+        case TRACE_CAPTURE:
+          stats->captures++;
+          stats->capture_turns[record.turn < REPLAY_MAX_TURN ?
+                               record.turn : REPLAY_MAX_TURN - 1]++;
+          break;
+        case TRACE_END:
+          if (record.count == 1)
+            {
+              uint32_t winner;
+              memcpy (&winner, data + offset - sizeof (winner),
+                      sizeof (winner));
+              stats->wins[winner != 0]++;
+            }
+          break;
+        default:
+          stats->corrupted++;
+          return;
+        }
+    }
+}
+
+/*
+ * Map a trace file and scan it, returning false if it is not a trace
+ */
+bool replay_file (replay_stats * stats, const char *filename)
+{
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < 2 * sizeof (uint32_t))
+    {
+      close (fd);
+      return false;
+    }
+  unsigned char *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd,
+                              0);
+  close (fd);
+  if (data == MAP_FAILED)
+    return false;
+  uint32_t header[2];
+  memcpy (header, data, sizeof (header));
+  bool valid = header[0] == TRACE_MAGIC && header[1] == TRACE_VERSION;
+  if (valid)
+    {
+      posix_madvise (data, st.st_size, POSIX_MADV_SEQUENTIAL);
+      replay_scan (stats, data, st.st_size);
+    }
+  munmap (data, st.st_size);
+  return valid;
+}
+
+int main (int argc, const char *argv[])
+{
+  if (argc < 2)
+    {
+      fprintf (stderr, "Incorrect number of arguments: ./replay trace...\n");
+      exit (-1);
+    }
+  replay_stats *stats = calloc (1, sizeof (*stats));
+  struct timespec start, end;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (int i = 1; i < argc; i++)
+    if (!replay_file (stats, argv[i]))
+      fprintf (stderr, "Error reading trace %s\n", argv[i]);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double elapsed = (end.tv_sec - start.tv_sec)
+    + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  const char *names[] = { "cops", "robbers" };
+  printf ("Matches: %zu\n", stats->matches);
+  printf ("Moves: %zu\n", stats->moves);
+  printf ("Captures: %zu\n", stats->captures);
+  for (size_t side = 0; side < 2; side++)
+    {
+      size_t moves = stats->side_moves[side] == 0 ? 1 :
+        stats->side_moves[side];
+      printf ("%s: %zu wins, max latency %u us, mean latency %.1f us, "
+              "%zu near misses, %zu timeouts\n", names[side],
+              stats->wins[side], stats->latency_max[side],
+              (double) stats->latency_sum[side] / moves,
+              stats->near_misses[side], stats->timeouts[side]);
+    }
+  printf ("Capture turns:\n");
+  for (size_t turn = 0; turn < REPLAY_MAX_TURN; turn++)
+    if (stats->capture_turns[turn] != 0)
+      printf ("%zu %zu\n", turn, stats->capture_turns[turn]);
+  if (stats->corrupted != 0)
+    printf ("Corrupted traces: %zu\n", stats->corrupted);
+  printf ("Scanned %zu moves in %.3f s (%.0f moves/s)\n", stats->moves,
+          elapsed, elapsed > 0 ? stats->moves / elapsed : 0.0);
+  free (stats);
+}
@@ -1,9 +1,55 @@
 from subprocess import PIPE, DEVNULL, Popen
 import multiprocessing
+import os
 import re
+import struct
+import time
 from turtle import *
 import sys
 
+TRACE_MAGIC = 0x52545054
+TRACE_VERSION = 2
+TRACE_MATCH, TRACE_MOVE, TRACE_CAPTURE, TRACE_END = range(4)
+TRACE_WRITER_SERVER = 0
+
+
+class Trace:
+    """Append-only binary trace in the format of trace.h"""
+
+    def __init__(self, filename):
+        # Only the process creating the file writes the header, at once
+        flags = os.O_WRONLY | os.O_APPEND
+        try:
+            fd = os.open(filename, flags | os.O_CREAT | os.O_EXCL, 0o644)
+            created = True
+        except FileExistsError:
+            fd = os.open(filename, flags)
+            created = False
+        self.file = os.fdopen(fd, "ab", buffering=1 << 16)
+        if created:
+            self.file.write(struct.pack("<II", TRACE_MAGIC, TRACE_VERSION))
+            self.file.flush()
+
+    def write(self, kind, side, turn, latency, words):
+        self.file.write(
+            struct.pack(f"<BBHIII{len(words)}I", kind, side,
+                        TRACE_WRITER_SERVER, len(words), turn,
+                        min(latency, 0xFFFFFFFF), *words)
+        )
+
+    def close(self):
+        self.file.close()
+
+
+def board_hash(values, neighbors, weights):
+    """64-bit FNV-1a hash computed like board_hash in algo.c"""
+    h = 14695981039346656037
+    values = values + [x for n in neighbors for x in [len(n)] + n]
+    for v in values + [x for w in weights for x in w]:
+        for b in v.to_bytes(8, "little"):
+            h = ((h ^ b) * 1099511628211) & 0xFFFFFFFFFFFFFFFF
+    return h
+
 
 class Positions:
     def __init__(self, length, stdout, stdin, game):
@@ -14,7 +60,7 @@ class Positions:
         self.turtles = None
 
     def remove_captured(self):
-        if self.positions[0] == -1:
+        if len(self.positions) == 0 or self.positions[0] == -1:
             return
         positions, turtles = [], []
         for i, pos in enumerate(self.positions):
@@ -24,6 +70,7 @@ class Positions:
                     turtles.append(self.turtles[i])
             else:
                 print("Captured robber at position " + str(pos))
+                self.game.trace(TRACE_CAPTURE, 1, self.game.turn(), 0, [pos])
                 if self.game.graphic:
                     self.turtles[i].pendown()
                     self.turtles[i].color("green")
@@ -47,8 +94,11 @@ class Positions:
     def new_positions(self):
         return_vector = multiprocessing.Manager().list(self.positions)
         p = multiprocessing.Process(target=self.read_positions, args=(return_vector,))
+        start = time.monotonic()
         p.start()
         p.join(1)
+        latency = int((time.monotonic() - start) * 1000000)
+        side = 0 if self is self.game.cops else 1
         if p.is_alive():
             p.kill()
             print("Timeout")
@@ -59,12 +109,13 @@ class Positions:
             if i != -1 and not self.game.M[i][j]:
                 print("Illegal move")
                 return False
-        self.positions = return_vector
+        self.positions = list(return_vector)
+        self.game.trace(TRACE_MOVE, side, self.game.turn(), latency, self.positions)
         return True
 
 
 class Game:
-    def __init__(self, cops_prog, robbers_prog, filename, graphic):
+    def __init__(self, cops_prog, robbers_prog, filename, graphic, trace=None):
         try:
             with open(filename) as inst:
                 cops = int(*re.findall(r"\d+", inst.readline()))
@@ -77,12 +128,20 @@ class Game:
                 ]
                 edges = int(*re.findall(r"\d+", inst.readline()))
                 self.M = [[False] * vertices for _ in range(vertices)]
+                neighbors = [[] for _ in range(vertices)]
+                weights = [[] for _ in range(vertices)]
+                weighted = False
                 for i in range(vertices):
                     self.M[i][i] = True
                 for _ in range(edges):
-                    i, j = map(int, re.findall(r"\d+", inst.readline()))
+                    i, j, *w = map(int, re.findall(r"\d+", inst.readline()))
                     self.M[i][j] = True
                     self.M[j][i] = True
+                    neighbors[i].append(j)
+                    neighbors[j].append(i)
+                    weights[i].append(w[0] if w else 1)
+                    weights[j].append(w[0] if w else 1)
+                    weighted = weighted or len(w) != 0
         except Exception as e:
             print(f"Error while parsing board file: {e}")
             exit(1)
@@ -105,9 +164,28 @@ class Game:
         self.remaining_turn = self.max_turn + 2
         self.cops_turn = True
         self.graphic = graphic == "1"
+        self.trace_file = None
+        if trace is not None:
+            self.trace_file = Trace(trace)
+            h = board_hash(
+                [vertices, cops, robbers, self.max_turn],
+                neighbors,
+                weights if weighted else [],
+            )
+            self.trace(
+                TRACE_MATCH, 0, 0, 0,
+                [h & 0xFFFFFFFF, h >> 32, vertices, cops, robbers, self.max_turn],
+            )
         if self.graphic:
             self.init_screen()
 
+    def turn(self):
+        return self.max_turn + 2 - self.remaining_turn
+
+    def trace(self, kind, side, turn, latency, words):
+        if self.trace_file is not None:
+            self.trace_file.write(kind, side, turn, latency, words)
+
     def init_screen(self):
         self.screen = Screen()
         self.screen.tracer(0)
@@ -217,6 +295,9 @@ class Game:
         else:
             msg = "Robbers win!"
         print(msg)
+        self.trace(TRACE_END, 0, self.turn(), 0, [int(len(g.robbers.positions) != 0)])
+        if self.trace_file is not None:
+            self.trace_file.close()
         # Update graphic counter
         if self.graphic:
             self.counter.clear()
@@ -225,11 +306,11 @@ class Game:
 
 
 if __name__ == "__main__":
-    if len(sys.argv) != 5:
-        print("Usage: python ./server.py cops robbers filename 0/1")
+    if len(sys.argv) not in (5, 6):
+        print("Usage: python ./server.py cops robbers filename 0/1 [trace]")
         exit(1)
 
-    g = Game(sys.argv[1], sys.argv[2], sys.argv[3], sys.argv[4])
+    g = Game(*sys.argv[1:])
 
     # Main loop
     while len(g.robbers.positions) != 0 and g.remaining_turn != 0:
@@ -0,0 +1,57 @@
+#include "algo.h"
+#include "tablebase.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main (int argc, const char *argv[])
+{
+  if (argc != 2 && argc != 3)
+    {
+      fprintf (stderr, "Incorrect number of arguments: ./solve filename "
+               "[threads]\n");
+      exit (-1);
+    }
+  FILE *file = fopen (argv[1], "r");
+  if (file == NULL)
+    {
+      fprintf (stderr, "Error opening input file\n");
+      exit (-1);
+    }
+  board b;
+  board_create (&b);
+  bool success = board_read_from (&b, file);
+  fclose (file);
+  if (!success)
+    {
+      fprintf (stderr, "Error parsing input file\n");
+      exit (-1);
+    }
+
+  tablebase tb;
+  tablebase_create (&tb);
+  size_t threads = argc == 3 ? (size_t) atoi (argv[2]) : 0;
+  if (!tablebase_solve (&tb, &b, threads))
+    {
+      fprintf (stderr, "Board is too large to be solved\n");
+      board_destroy (&b);
+      exit (1);
+    }
+
+  char path[4096];
+  snprintf (path, sizeof (path), "%s.tb", argv[1]);
+  if (!tablebase_write (&tb, &b, path))
+    {
+      fprintf (stderr, "Error writing %s\n", path);
+      tablebase_destroy (&tb);
+      board_destroy (&b);
+      exit (1);
+    }
+
+  size_t won = 0;
+  for (size_t s = 0; s < tb.states; s++)
+    won += tb.cops_dtc[s] != TABLEBASE_LOST;
+  printf ("%s: %zu states, %zu won by cops to move\n", path, tb.states, won);
+  tablebase_destroy (&tb);
+  board_destroy (&b);
+}
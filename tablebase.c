@@ -0,0 +1,482 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "tablebase.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TABLEBASE_MAGIC 0x42545054u
+#define TABLEBASE_VERSION 1u
+
+/*
+ * File header, followed by the cops_dtc then robbers_dtc tables
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t hash;
+  uint64_t size;
+  uint64_t cops;
+  uint64_t horizon;
+  uint64_t states;
+  uint64_t reserved[2];
+} tablebase_header;
+
+/*
+ * Bit sets and strides shared by the solver threads
+ */
+typedef struct
+{
+  board *b;
+  size_t cops;
+  size_t states;
+  size_t *stride;
+  const uint64_t *source;
+  uint64_t *target;
+  const uint64_t *captured;
+  size_t piece;
+  bool (*step) (void *, size_t);
+} tablebase_solver;
+
+typedef struct
+{
+  tablebase_solver *solver;
+  size_t begin;
+  size_t end;
+} tablebase_job;
+
+void tablebase_create (tablebase * self)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  self->size = 0;
+  self->cops = 0;
+  self->horizon = 0;
+  self->states = 0;
+  self->cops_dtc = NULL;
+  self->robbers_dtc = NULL;
+  self->data = NULL;
+  self->data_size = 0;
+  self->mapped = false;
+}
+
+void tablebase_destroy (tablebase * self)
+{
+  if (self == NULL)
+    {
+      return;
+    }
+  if (self->mapped)
+    {
+      munmap (self->data, self->data_size);
+    }
+  else
+    {
+      free (self->data);
+    }
+  tablebase_create (self);
+}
+
+size_t tablebase_states (board * b)
+{
+  if (b == NULL || b->cops == 0 || b->size == 0)
+    {
+      return 0;
+    }
+  size_t states = b->size;
+  for (size_t i = 0; i < b->cops; i++)
+    {
+      if (states > TABLEBASE_MAX_STATES / b->size)
+        {
+          return 0;
+        }
+      states *= b->size;
+    }
+  return states;
+}
+
+static inline bool tablebase_bit (const uint64_t *set, size_t i)
+{
+  return (set[i / 64] >> (i % 64)) & 1;
+}
+
+/*
+ * Compute the states of target where moving cop piece can reach a
+ * state of source
+ */
+static bool tablebase_cop_step (void *arg, size_t s)
+{
+  tablebase_solver *solver = arg;
+  size_t stride = solver->stride[solver->piece];
+  size_t d = (s / stride) % solver->b->size;
+  if (tablebase_bit (solver->source, s))
+    {
+      return true;
+    }
+  board_vertex *vertex = solver->b->vertices[d];
+  for (size_t i = 0; i < vertex->degree; i++)
+    {
+      size_t m = vertex->neighbors[i]->index;
+      if (tablebase_bit (solver->source, s - d * stride + m * stride))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/*
+ * Compute the states of target where every robber move leads to a
+ * state of source (cops to move) or the robber is already captured
+ */
+static bool tablebase_robber_step (void *arg, size_t s)
+{
+  tablebase_solver *solver = arg;
+  if (tablebase_bit (solver->captured, s))
+    {
+      return true;
+    }
+  size_t r = s % solver->b->size;
+  if (!tablebase_bit (solver->source, s))
+    {
+      return false;
+    }
+  board_vertex *vertex = solver->b->vertices[r];
+  for (size_t i = 0; i < vertex->degree; i++)
+    {
+      size_t m = vertex->neighbors[i]->index;
+      if (!tablebase_bit (solver->source, s - r + m))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+/*
+ * Compute the states where the robber shares a vertex with a cop
+ */
+static bool tablebase_captured_step (void *arg, size_t s)
+{
+  tablebase_solver *solver = arg;
+  size_t r = s % solver->b->size;
+  for (size_t i = 0; i < solver->cops; i++)
+    {
+      if ((s / solver->stride[i]) % solver->b->size == r)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+static void *tablebase_run_job (void *arg)
+{
+  tablebase_job *job = arg;
+  tablebase_solver *solver = job->solver;
+  for (size_t w = job->begin; w < job->end; w++)
+    {
+      uint64_t word = 0;
+      size_t last = (w + 1) * 64 < solver->states ?
+        64 : solver->states - w * 64;
+      for (size_t j = 0; j < last; j++)
+        {
+          if (solver->step (solver, w * 64 + j))
+            {
+              word |= (uint64_t) 1 << j;
+            }
+        }
+      solver->target[w] = word;
+    }
+  return NULL;
+}
+
+/*
+ * Run one phase over all words of target, split in contiguous ranges
+ * between threads so that no word is written by two threads
+ */
+static void tablebase_run_phase (tablebase_solver * solver, size_t threads,
+                                 bool (*step) (void *, size_t))
+{
+  size_t words = (solver->states + 63) / 64;
+  pthread_t *ids = calloc (threads, sizeof (*ids));
+  tablebase_job *jobs = calloc (threads, sizeof (*jobs));
+  solver->step = step;
+  for (size_t t = 0; t < threads; t++)
+    {
+      jobs[t].solver = solver;
+      jobs[t].begin = words * t / threads;
+      jobs[t].end = words * (t + 1) / threads;
+      if (t + 1 == threads
+          || pthread_create (&ids[t], NULL, tablebase_run_job, &jobs[t]) != 0)
+        {
+          // The last job runs on the calling thread
+          tablebase_run_job (&jobs[t]);
+          ids[t] = pthread_self ();
+        }
+    }
+  for (size_t t = 0; t < threads; t++)
+    {
+      if (!pthread_equal (ids[t], pthread_self ()))
+        {
+          pthread_join (ids[t], NULL);
+        }
+    }
+  free (ids);
+  free (jobs);
+}
+
+/*
+ * Record moves distance for states of current that were not in
+ * previous and return the number of such states
+ */
+static size_t tablebase_record (uint8_t * dtc, const uint64_t *previous,
+                                const uint64_t *current, size_t words,
+                                size_t moves)
+{
+  size_t added = 0;
+  for (size_t w = 0; w < words; w++)
+    {
+      uint64_t diff = current[w] & ~previous[w];
+      while (diff != 0)
+        {
+          size_t j = __builtin_ctzll (diff);
+          dtc[w * 64 + j] = moves;
+          diff &= diff - 1;
+          added++;
+        }
+    }
+  return added;
+}
+
+bool tablebase_solve (tablebase * self, board * b, size_t threads)
+{
+  if (self == NULL || b == NULL)
+    {
+      return false;
+    }
+  size_t states = tablebase_states (b);
+  if (states == 0)
+    {
+      return false;
+    }
+  if (threads == 0)
+    {
+      long online = sysconf (_SC_NPROCESSORS_ONLN);
+      threads = online > 0 ? (size_t) online : 1;
+    }
+
+  tablebase_destroy (self);
+  uint8_t *data = malloc (2 * states);
+  memset (data, TABLEBASE_LOST, 2 * states);
+  self->size = b->size;
+  self->cops = b->cops;
+  self->horizon = b->max_turn < TABLEBASE_LOST ? b->max_turn :
+    TABLEBASE_LOST - 1;
+  self->states = states;
+  self->data = data;
+  self->data_size = 2 * states;
+  self->cops_dtc = data;
+  self->robbers_dtc = data + states;
+
+  tablebase_solver solver;
+  solver.b = b;
+  solver.cops = b->cops;
+  solver.states = states;
+  solver.stride = calloc (b->cops + 1, sizeof (*solver.stride));
+  solver.stride[b->cops] = 1;
+  for (size_t i = b->cops; i > 0; i--)
+    {
+      solver.stride[i - 1] = solver.stride[i] * b->size;
+    }
+
+  // level[i] holds states from which moving cops i, i + 1, ... reaches
+  // a robber winning state, level[cops] being the robber winning states
+  size_t words = (states + 63) / 64;
+  uint64_t *captured = calloc (words, sizeof (uint64_t));
+  uint64_t *cops_win = calloc (words, sizeof (uint64_t));
+  uint64_t *robbers_win = calloc (words, sizeof (uint64_t));
+  uint64_t *robbers_next = calloc (words, sizeof (uint64_t));
+  uint64_t **level = calloc (b->cops, sizeof (*level));
+  for (size_t i = 0; i < b->cops; i++)
+    {
+      level[i] = calloc (words, sizeof (uint64_t));
+    }
+
+  solver.captured = captured;
+  solver.target = captured;
+  tablebase_run_phase (&solver, threads, tablebase_captured_step);
+  memcpy (cops_win, captured, words * sizeof (uint64_t));
+  memcpy (robbers_win, captured, words * sizeof (uint64_t));
+  tablebase_record (data, robbers_next, captured, words, 0);
+  tablebase_record (data + states, robbers_next, captured, words, 0);
+
+  for (size_t moves = 1; moves <= self->horizon; moves++)
+    {
+      // Cops to move win in moves if a cop move reaches a robber state
+      // won in moves - 1
+      for (size_t i = b->cops; i > 0; i--)
+        {
+          solver.piece = i - 1;
+          solver.source = i == b->cops ? robbers_win : level[i];
+          solver.target = level[i - 1];
+          tablebase_run_phase (&solver, threads, tablebase_cop_step);
+        }
+
+      // Robber to move loses in moves if every move reaches a cop state
+      // won in moves - 1
+      solver.source = cops_win;
+      solver.target = robbers_next;
+      tablebase_run_phase (&solver, threads, tablebase_robber_step);
+
+      size_t added = tablebase_record (data, cops_win, level[0], words,
+                                       moves);
+      added += tablebase_record (data + states, robbers_win, robbers_next,
+                                 words, moves);
+      uint64_t *swap = cops_win;
+      cops_win = level[0];
+      level[0] = swap;
+      swap = robbers_win;
+      robbers_win = robbers_next;
+      robbers_next = swap;
+      if (added == 0)
+        {
+          break;
+        }
+    }
+
+  for (size_t i = 0; i < b->cops; i++)
+    {
+      free (level[i]);
+    }
+  free (level);
+  free (captured);
+  free (cops_win);
+  free (robbers_win);
+  free (robbers_next);
+  free (solver.stride);
+  return true;
+}
+
+bool tablebase_write (tablebase * self, board * b, const char *filename)
+{
+  if (self == NULL || b == NULL || filename == NULL || self->states == 0)
+    {
+      return false;
+    }
+  // Write to a temporary file renamed at the end, so that concurrent
+  // readers never map a partially written tablebase
+  char temporary[4096];
+  snprintf (temporary, sizeof (temporary), "%s.%ld", filename,
+            (long) getpid ());
+  FILE *file = fopen (temporary, "wb");
+  if (file == NULL)
+    {
+      return false;
+    }
+  tablebase_header header;
+  memset (&header, 0, sizeof (header));
+  header.magic = TABLEBASE_MAGIC;
+  header.version = TABLEBASE_VERSION;
+  header.hash = board_hash (b);
+  header.size = self->size;
+  header.cops = self->cops;
+  header.horizon = self->horizon;
+  header.states = self->states;
+  bool success = fwrite (&header, sizeof (header), 1, file) == 1
+    && fwrite (self->cops_dtc, 1, self->states, file) == self->states
+    && fwrite (self->robbers_dtc, 1, self->states, file) == self->states;
+  success = fclose (file) == 0 && success
+    && rename (temporary, filename) == 0;
+  if (!success)
+    {
+      remove (temporary);
+    }
+  return success;
+}
+
+bool tablebase_load (tablebase * self, board * b, const char *filename)
+{
+  if (self == NULL || b == NULL || filename == NULL)
+    {
+      return false;
+    }
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    {
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (tablebase_header))
+    {
+      close (fd);
+      return false;
+    }
+  void *data = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+      return false;
+    }
+
+  const tablebase_header *header = data;
+  if (header->magic != TABLEBASE_MAGIC
+      || header->version != TABLEBASE_VERSION
+      || header->hash != board_hash (b) || header->size != b->size
+      || header->cops != b->cops || header->states != tablebase_states (b)
+      || (size_t) st.st_size != sizeof (*header) + 2 * header->states)
+    {
+      munmap (data, st.st_size);
+      return false;
+    }
+
+  tablebase_destroy (self);
+  self->size = header->size;
+  self->cops = header->cops;
+  self->horizon = header->horizon;
+  self->states = header->states;
+  self->data = data;
+  self->data_size = st.st_size;
+  self->mapped = true;
+  self->cops_dtc = (const uint8_t *) data + sizeof (*header);
+  self->robbers_dtc = self->cops_dtc + self->states;
+  return true;
+}
+
+size_t tablebase_index (tablebase * self, const size_t *cops, size_t robber)
+{
+  size_t index = 0;
+  for (size_t i = 0; i < self->cops; i++)
+    {
+      index = index * self->size + cops[i];
+    }
+  return index * self->size + robber;
+}
+
+unsigned int tablebase_cops_dtc (tablebase * self, const size_t *cops,
+                                 size_t robber)
+{
+  if (self == NULL || self->states == 0)
+    {
+      return TABLEBASE_LOST;
+    }
+  return self->cops_dtc[tablebase_index (self, cops, robber)];
+}
+
+unsigned int tablebase_robbers_dtc (tablebase * self, const size_t *cops,
+                                    size_t robber)
+{
+  if (self == NULL || self->states == 0)
+    {
+      return TABLEBASE_LOST;
+    }
+  return self->robbers_dtc[tablebase_index (self, cops, robber)];
+}
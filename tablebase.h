@@ -0,0 +1,94 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "algo.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Distance to capture of states the cops cannot win within the
+ * horizon
+ */
+#define TABLEBASE_LOST 255
+
+/*
+ * Largest number of (cops, robber) positions the solver accepts
+ */
+#define TABLEBASE_MAX_STATES ((size_t) 1 << 26)
+
+/*
+ * Exact results for the board cops against a single robber: a state
+ * is the position of each cop and of the robber, indexed in base size
+ * with the first cop as most significant digit. cops_dtc and
+ * robbers_dtc hold the number of moves before capture under perfect
+ * play when cops or robber are to move, TABLEBASE_LOST if the robber
+ * survives the horizon
+ */
+typedef struct
+{
+  size_t size;
+  size_t cops;
+  size_t horizon;
+  size_t states;
+  const uint8_t *cops_dtc;
+  const uint8_t *robbers_dtc;
+  void *data;
+  size_t data_size;
+  bool mapped;
+} tablebase;
+
+/*
+ * Create an empty tablebase by initializing each member
+ */
+void tablebase_create (tablebase * self);
+
+/*
+ * Destroy a tablebase by freeing or unmapping its tables
+ */
+void tablebase_destroy (tablebase * self);
+
+/*
+ * Return the number of states needed to solve the board, 0 if it
+ * cannot be solved (no cops or more than TABLEBASE_MAX_STATES states)
+ */
+size_t tablebase_states (board * b);
+
+/*
+ * Solve the board by backward induction over its max_turn moves using
+ * threads threads (0 for one per online processor) and return false
+ * if the board is too large
+ */
+bool tablebase_solve (tablebase * self, board * b, size_t threads);
+
+/*
+ * Write the tablebase to a file that tablebase_load can map
+ */
+bool tablebase_write (tablebase * self, board * b, const char *filename);
+
+/*
+ * Map a tablebase file and return false if it is missing or does not
+ * match the board
+ */
+bool tablebase_load (tablebase * self, board * b, const char *filename);
+
+/*
+ * Return the index of the state with cops on vertices cops and robber
+ * on vertex robber
+ */
+size_t tablebase_index (tablebase * self, const size_t *cops, size_t robber);
+
+/*
+ * Return the distance to capture when cops are to move
+ */
+unsigned int tablebase_cops_dtc (tablebase * self, const size_t *cops,
+                                 size_t robber);
+
+/*
+ * Return the distance to capture when the robber is to move
+ */
+unsigned int tablebase_robbers_dtc (tablebase * self, const size_t *cops,
+                                    size_t robber);
+
+#endif // TABLEBASE_H
@@ -0,0 +1,117 @@
+#define _XOPEN_SOURCE 700
+
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+bool trace_open (trace * self, const char *filename,
+                 enum trace_writer writer)
+{
+  if (self == NULL || filename == NULL)
+    {
+      return false;
+    }
+  self->used = 0;
+  self->writer = writer;
+  // Only the process creating the file writes the header
+  bool created = true;
+  int fd = open (filename, O_WRONLY | O_APPEND | O_CREAT | O_EXCL, 0644);
+  if (fd < 0 && errno == EEXIST)
+    {
+      created = false;
+      fd = open (filename, O_WRONLY | O_APPEND);
+    }
+  if (fd < 0)
+    {
+      return false;
+    }
+  self->file = fdopen (fd, "ab");
+  if (self->file == NULL)
+    {
+      close (fd);
+      return false;
+    }
+  // Records are buffered here, not by stdio
+  setvbuf (self->file, NULL, _IONBF, 0);
+  if (created)
+    {
+      uint32_t header[] = { TRACE_MAGIC, TRACE_VERSION };
+      fwrite (header, sizeof (header), 1, self->file);
+    }
+  return true;
+}
+
+void trace_flush (trace * self)
+{
+  if (self == NULL || self->file == NULL || self->used == 0)
+    {
+      return;
+    }
+  fwrite (self->buffer, 1, self->used, self->file);
+  self->used = 0;
+}
+
+void trace_write (trace * self, enum trace_type type, int side,
+                  uint32_t turn, uint32_t latency, const uint32_t *words,
+                  size_t count)
+{
+  if (self == NULL || self->file == NULL)
+    {
+      return;
+    }
+  size_t length = sizeof (trace_record) + count * sizeof (uint32_t);
+  if (count > UINT32_MAX)
+    {
+      fprintf (stderr, "Trace record of %zu words is too big\n", count);
+      return;
+    }
+  if (self->used + length > sizeof (self->buffer))
+    {
+      trace_flush (self);
+    }
+  unsigned char *target = self->buffer + self->used;
+  if (length > sizeof (self->buffer))
+    {
+      // Built apart and written at once so that appends stay whole
+      target = malloc (length);
+      if (target == NULL)
+        {
+          fprintf (stderr, "Could not write trace record of %zu words\n",
+                   count);
+          return;
+        }
+    }
+  trace_record record;
+  record.type = type;
+  record.side = side;
+  record.writer = self->writer;
+  record.count = count;
+  record.turn = turn;
+  record.latency = latency;
+  memcpy (target, &record, sizeof (record));
+  memcpy (target + sizeof (record), words, count * sizeof (uint32_t));
+  if (target != self->buffer + self->used)
+    {
+      if (fwrite (target, length, 1, self->file) != 1)
+        fprintf (stderr, "Could not write trace record of %zu words\n",
+                 count);
+      free (target);
+      return;
+    }
+  self->used += length;
+}
+
+void trace_close (trace * self)
+{
+  if (self == NULL || self->file == NULL)
+    {
+      return;
+    }
+  trace_flush (self);
+  fclose (self->file);
+  self->file = NULL;
+}
@@ -0,0 +1,88 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAGIC 0x52545054u
+#define TRACE_VERSION 2u
+
+/*
+ * Time allowed to each program for a move by server.py
+ */
+#define TRACE_TIMEOUT_US 1000000u
+
+/*
+ * Size of the buffer filled before each write
+ */
+#define TRACE_BUFFER_SIZE (1 << 16)
+
+enum trace_type
+{ TRACE_MATCH, TRACE_MOVE, TRACE_CAPTURE, TRACE_END };
+
+/*
+ * Program writing a trace. The server and both players of the same
+ * matches may share one file, but every match of a file must be traced
+ * by the same programs for replay to count each match once.
+ */
+enum trace_writer
+{ TRACE_WRITER_SERVER, TRACE_WRITER_COPS, TRACE_WRITER_ROBBERS };
+
+/*
+ * Every record is this header followed by count 32-bit words:
+ * - TRACE_MATCH: hash low, hash high, size, cops, robbers, max_turn
+ * - TRACE_MOVE: new position of each piece of side
+ * - TRACE_CAPTURE: vertex of the captured robber
+ * - TRACE_END: winning side
+ * turn is 0 and 1 for initial positions then increases by one per move
+ * and writer is the program that wrote the record
+ */
+typedef struct
+{
+  uint8_t type;
+  uint8_t side;
+  uint16_t writer;
+  uint32_t count;
+  uint32_t turn;
+  uint32_t latency;
+} trace_record;
+
+/*
+ * Append-only trace file written through a fixed buffer
+ */
+typedef struct
+{
+  FILE *file;
+  enum trace_writer writer;
+  size_t used;
+  unsigned char buffer[TRACE_BUFFER_SIZE];
+} trace;
+
+/*
+ * Open filename for appending records of writer, writing the file
+ * header only if this call creates it, and return false if it cannot
+ * be opened
+ */
+bool trace_open (trace * self, const char *filename,
+                 enum trace_writer writer);
+
+/*
+ * Append a record with count words, latency being in microseconds.
+ * Records bigger than the buffer are written directly in one write.
+ */
+void trace_write (trace * self, enum trace_type type, int side,
+                  uint32_t turn, uint32_t latency, const uint32_t *words,
+                  size_t count);
+
+/*
+ * Write buffered records to the file
+ */
+void trace_flush (trace * self);
+
+/*
+ * Flush and close the trace
+ */
+void trace_close (trace * self);
+
+#endif // TRACE_H